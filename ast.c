@@ -1,86 +1,243 @@
 #include"ast.h"
+#include"ast_arena.h"
+#include"metrics.h"
 #include<stdio.h>
 #include<stdlib.h>
 #include<assert.h>
 #include<string.h>
+#include<atomic>
 
 /* local helper functions */
-char * get_indent_str(int n){
-	char * ret = (char *) calloc(n+1, sizeof(char));
-	for (int i=0; i < n; i++)
-		ret[i] = ' ';
-	return ret;
+
+/* Allocates a zeroed node from the current thread's AstArena if there is one,
+otherwise from the heap */
+static astNode* allocNode(){
+	METRIC_COUNT(counter_nodes_created, 1);
+	AstArena *arena = currentAstArena();
+	if (arena != NULL)
+		return (astNode *) arena->allocate(sizeof(astNode));
+	return (astNode *) calloc(1, sizeof(astNode));
+}
+
+static std::atomic<unsigned> hashOptions(hash_names | hash_constants);
+
+void setAstHashOptions(unsigned options){
+	hashOptions.store(options, std::memory_order_relaxed);
+}
+
+unsigned getAstHashOptions(){
+	return hashOptions.load(std::memory_order_relaxed);
+}
+
+/* 64-bit finalizer from splitmix64 */
+static uint64_t mixHash(uint64_t h){
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+/* Order-sensitive combination, so swapping two children changes the hash */
+static uint64_t combineHash(uint64_t seed, uint64_t value){
+	return mixHash(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+/* A missing optional child still takes its slot, so "if without else" and
+"if with else" hash differently */
+static const uint64_t NULL_CHILD_HASH = 0x6a09e667f3bcc909ULL;
+
+static void addChild(astNode *node, astNode *child, uint64_t &h){
+	if (child == NULL){
+		h = combineHash(h, NULL_CHILD_HASH);
+		return;
+	}
+	h = combineHash(h, child->hash);
+	node->size += child->size;
+}
+
+/* Fills in size and hash of node from its own fields and its (already sealed) children */
+static void sealNode(astNode *node){
+	unsigned options = getAstHashOptions();
+	uint64_t h = combineHash(0, (uint64_t) node->type + 1);
+	node->size = 1;
+
+	switch(node->type){
+		case ast_prog:
+			addChild(node, node->prog.ext1, h);
+			addChild(node, node->prog.ext2, h);
+			addChild(node, node->prog.func, h);
+			break;
+		case ast_func:
+			if (options & hash_names)
+				h = combineHash(h, symbolHash(node->func.name));
+			addChild(node, node->func.param, h);
+			addChild(node, node->func.body, h);
+			break;
+		case ast_extern:
+			if (options & hash_names)
+				h = combineHash(h, symbolHash(node->ext.name));
+			break;
+		case ast_var:
+			if (options & hash_names)
+				h = combineHash(h, symbolHash(node->var.name));
+			break;
+		case ast_cnst:
+			if (options & hash_constants)
+				h = combineHash(h, (uint64_t) (uint32_t) node->cnst.value);
+			break;
+		case ast_rexpr:
+			h = combineHash(h, (uint64_t) node->rexpr.op);
+			addChild(node, node->rexpr.lhs, h);
+			addChild(node, node->rexpr.rhs, h);
+			break;
+		case ast_bexpr:
+			h = combineHash(h, (uint64_t) node->bexpr.op);
+			addChild(node, node->bexpr.lhs, h);
+			addChild(node, node->bexpr.rhs, h);
+			break;
+		case ast_uexpr:
+			h = combineHash(h, (uint64_t) node->uexpr.op);
+			addChild(node, node->uexpr.expr, h);
+			break;
+		case ast_stmt:{
+			astStmt *stmt = &node->stmt;
+			h = combineHash(h, (uint64_t) stmt->type + 1);
+			switch(stmt->type){
+				case ast_call:
+					if (options & hash_names)
+						h = combineHash(h, symbolHash(stmt->call.name));
+					addChild(node, stmt->call.param, h);
+					break;
+				case ast_ret:
+					addChild(node, stmt->ret.expr, h);
+					break;
+				case ast_block:
+					h = combineHash(h, stmt->block.stmt_list->size());
+					for (astNode *child : *(stmt->block.stmt_list))
+						addChild(node, child, h);
+					break;
+				case ast_while:
+					addChild(node, stmt->whilen.cond, h);
+					addChild(node, stmt->whilen.body, h);
+					break;
+				case ast_if:
+					addChild(node, stmt->ifn.cond, h);
+					addChild(node, stmt->ifn.if_body, h);
+					addChild(node, stmt->ifn.else_body, h);
+					break;
+				case ast_asgn:
+					addChild(node, stmt->asgn.lhs, h);
+					addChild(node, stmt->asgn.rhs, h);
+					break;
+				case ast_decl:
+					if (options & hash_names)
+						h = combineHash(h, symbolHash(stmt->decl.name));
+					break;
+			}
+			break;
+		}
+	}
+	node->hash = h;
+}
+
+void rehashNode(astNode *node){
+	sealNode(node);
+}
+
+/* rehashTree seals a node only after all of its children, walking the tree with
+an explicit stack of nodes; childrenDone marks an entry whose children are
+already sealed */
+typedef struct {
+	astNode *node;
+	bool childrenDone;
+} rehashItem;
+
+static thread_local vector<rehashItem> rehashStack;
+
+void rehashTree(astNode *root){
+	if (root == NULL)
+		return;
+	size_t base = rehashStack.size();
+	rehashStack.push_back({root, false});
+	while (rehashStack.size() > base){
+		rehashItem item = rehashStack.back();
+		rehashStack.pop_back();
+		if (item.childrenDone){
+			sealNode(item.node);
+			continue;
+		}
+		rehashStack.push_back({item.node, true});
+		forEachChild(item.node, [](astNode *child){
+			if (child != NULL)
+				rehashStack.push_back({child, false});
+		});
+	}
 }
 
 /* create and free functions for ast_prog type astNode */
 astNode* createProg(astNode *ext1, astNode	*ext2, astNode	*func){
 	astNode	*node;
-	node = (astNode *)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_prog;
 
 	node->prog.ext1 = ext1;
 	node->prog.ext2 = ext2;
 	node->prog.func = func;
 	
+	sealNode(node);
 	return(node); 
 }
 
 void freeProg(astNode *node){
 	assert(node != NULL && node->type == ast_prog);
-	
-	freeExtern(node->prog.ext1);
-	freeExtern(node->prog.ext2);
-	freeFunc(node->prog.func);
-	
-	free(node);
-	return;
+	freeNode(node);
 }
 
 /*create and free functions for ast_func type astNode */
-astNode* createFunc(const char *name, astNode *param, astNode* body){
+astNode* createFunc(symbol_id name, astNode *param, astNode* body){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_func;
 
-	node->func.name = (char *) calloc(1, sizeof(char) * (strlen(name)+1));
-	strcpy(node->func.name, name);
+	node->func.name = name;
 
 	node->func.param = param;
 	node->func.body = body;
 
+	sealNode(node);
 	return node;
 }
 
+astNode* createFunc(const char *name, astNode *param, astNode* body){
+	return createFunc(internSymbol(name), param, body);
+}
+
 void freeFunc(astNode *node){
 	assert(node != NULL && node->type == ast_func);
-	
-	free(node->func.name);
-	if (node->func.param != NULL)
-		freeVar(node->func.param);
-
-	freeBlock(node->func.body);
-	
-	free(node);
-	
-	return;
+	freeNode(node);
 }
 /*create and free functionns for ast_extern*/
 
-astNode* createExtern(const char *name){
+astNode* createExtern(symbol_id name){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_extern;
 	
-	node->ext.name = (char *) calloc(1, sizeof(char) * (strlen(name)+1));
-	strcpy(node->ext.name, name);
+	node->ext.name = name;
 
+	sealNode(node);
 	return(node);
 }
 
+astNode* createExtern(const char *name){
+	return createExtern(internSymbol(name));
+}
+
 void freeExtern(astNode *node){
 	assert(node != NULL && node->type == ast_extern);
 	
-	free(node->ext.name);
 	free(node);
 
 	return;
@@ -88,22 +245,25 @@ void freeExtern(astNode *node){
 
 /*create and free functions for ast_var*/
 
-astNode* createVar(const char *name){
+astNode* createVar(symbol_id name){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_var;
 	
-	node->var.name = (char *) calloc(1, sizeof(char) * (strlen(name)+1));
-	strcpy(node->var.name, name);
+	node->var.name = name;
 	
+	sealNode(node);
 	return(node);
 }
 
+astNode* createVar(const char *name){
+	return createVar(internSymbol(name));
+}
+
 void freeVar(astNode *node){
 
 	assert(node != NULL && node->type == ast_var);
 	
-	free(node->var.name);
 	free(node);
 
 	return;
@@ -112,10 +272,11 @@ void freeVar(astNode *node){
 /*create and free functions for ast_cnst type of node*/
 astNode* createCnst(int value){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_cnst;
 
 	node->cnst.value = value;
+	sealNode(node);
 	return(node);
 }
 
@@ -129,176 +290,149 @@ void freeCnst(astNode *node){
 /*create and free functions for ast_rexpr type of node*/
 astNode* createRExpr(astNode *lhs, astNode *rhs, rop_type op){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_rexpr;
 	
 	node->rexpr.lhs = lhs;
 	node->rexpr.rhs = rhs;
 	node->rexpr.op = op;
 
+	sealNode(node);
 	return(node);
 }
 
 void freeRExpr(astNode *node){
 	assert(node != NULL && node->type == ast_rexpr);
-	
-	// We call freeNode as we don't know the type of nodes for lhs and rhs
-	freeNode(node->rexpr.lhs);
-	freeNode(node->rexpr.rhs);
-	free(node);
-
-	return;
+	freeNode(node);
 }
 
 
 /*create and free functions for ast_bexpr type of node*/
 astNode* createBExpr(astNode *lhs, astNode *rhs, op_type op){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_bexpr;
 	
 	node->bexpr.lhs = lhs;
 	node->bexpr.rhs = rhs;
 	node->bexpr.op = op;
 
+	sealNode(node);
 	return(node);
 }
 
 void freeBExpr(astNode *node){
 	assert(node != NULL && node->type == ast_bexpr);
-	
-	//We call freeNode as we don't know the type of nodes for rhs and lhs
-	freeNode(node->bexpr.lhs);
-	freeNode(node->bexpr.rhs);
-
-	free(node);
-
-	return;
+	freeNode(node);
 }
 
 /* create and free functions for ast_uexpr type of node */
 astNode* createUExpr(astNode *expr, op_type op){
 	astNode *node;
-	node = (astNode*)calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_uexpr;
 	
 	node->uexpr.expr = expr;
 	node->uexpr.op = op;
 	
+	sealNode(node);
 	return(node);
 }
 
 void freeUExpr(astNode *node){
 	assert(node != NULL && node->type == ast_uexpr);
-	
-	freeNode(node->uexpr.expr);
-	free(node);
-
-	return;
+	freeNode(node);
 }
 
 /* create and free functions for a statement of type ast_call */
-astNode* createCall(const char *name, astNode *param){
+astNode* createCall(symbol_id name, astNode *param){
 	astNode *node;
-	node = (astNode*) calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_call;
 	
-	node->stmt.call.name = (char *) calloc(strlen(name) + 1, sizeof(char));
-	strcpy(node->stmt.call.name, name);
+	node->stmt.call.name = name;
 	
 	node->stmt.call.param = param;
 
+	sealNode(node);
 	return node;
 }
 
+astNode* createCall(const char *name, astNode *param){
+	return createCall(internSymbol(name), param);
+}
+
 void freeCall(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_call);
-	
-	free(node->stmt.call.name);
-	if (node->stmt.call.param != NULL)
-		freeNode(node->stmt.call.param);
-
-	free(node);
-	return;
+	freeNode(node);
 }
 
 /*create and free functions for a stmt of type ast_ret*/
 astNode* createRet(astNode	*expr){
 	astNode *node;
-	node = (astNode*) calloc(1, sizeof(astNode));
+	node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_ret;
 	
 	node->stmt.ret.expr = expr;
+	sealNode(node);
 	return(node);
 }
 
-void freeRet(astNode *node){	
+void freeRet(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_ret);
-
-	freeNode(node->stmt.ret.expr);
-	free(node);
-	return;
+	freeNode(node);
 }
 
 /*create and free functions for a stmt of type ast_block*/
 astNode* createBlock(vector<astNode*> *stmt_list){
 	vector<astNode*> slist;
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_block;
 	
 	node->stmt.block.stmt_list = stmt_list;
+
+	// the list is heap allocated by the parser, so the arena has to delete it on reset
+	AstArena *arena = currentAstArena();
+	if (arena != NULL)
+		arena->adoptList(stmt_list);
 	
+	sealNode(node);
 	return(node);
 }
 
 void freeBlock(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_block);
-
-	vector<astNode *> slist = *(node->stmt.block.stmt_list);
-	vector<astNode*>::iterator it = slist.begin();
-
-	while (it != slist.end()){
-		freeNode(*it);
-		it++;	
-	}
-	
-	delete(node->stmt.block.stmt_list);
-	free(node);
-	return;
+	freeNode(node);
 }
 
 /* create and free functions for stmt of type while*/
 astNode* createWhile(astNode *cond, astNode *body){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_while;
 	
 	node->stmt.whilen.cond = cond;
 	node->stmt.whilen.body = body;
 
+	sealNode(node);
 	return(node);	
 }
 
 void freeWhile(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_while);
-
-	freeNode(node->stmt.whilen.cond);
-	freeNode(node->stmt.whilen.body);
-	
-	free(node);
-	return;
+	freeNode(node);
 }
 
 /*create and free functions for stmt of type if*/
 astNode* createIf(astNode *cond, astNode *ifbody, astNode *elsebody){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_if;
 
@@ -306,113 +440,81 @@ astNode* createIf(astNode *cond, astNode *ifbody, astNode *elsebody){
 	node->stmt.ifn.if_body = ifbody;
 	node->stmt.ifn.else_body = elsebody;
 	
+	sealNode(node);
 	return(node);
 }
 
 void freeIf(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_if);
-	
-	freeNode(node->stmt.ifn.cond);
-	freeNode(node->stmt.ifn.if_body);
-	if (node->stmt.ifn.else_body != NULL)
-		freeNode(node->stmt.ifn.else_body);
-
-	free(node);	
-
-	return;
+	freeNode(node);
 }
 
 /* create and free functions of stmt type ast_decl */
-astNode* createDecl(const char *name){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+astNode* createDecl(symbol_id name){
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_decl;
 
-	node->stmt.decl.name = (char *)calloc(strlen(name)+1, sizeof(char));
-	strcpy(node->stmt.decl.name, name);
+	node->stmt.decl.name = name;
 
+	sealNode(node);
 	return(node);
 }
 
+astNode* createDecl(const char *name){
+	return createDecl(internSymbol(name));
+}
+
 void freeDecl(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_decl);
 	
-	free(node->stmt.decl.name);
 	free(node);
 }
 
 /* create and free functions of stmt type ast_assign */
 astNode* createAsgn(astNode *lhs, astNode *rhs){
-	astNode* node = (astNode *)calloc(1, sizeof(astNode));
+	astNode* node = allocNode();
 	node->type = ast_stmt;
 	node->stmt.type = ast_asgn;
 
 	node->stmt.asgn.lhs = lhs;
 	node->stmt.asgn.rhs = rhs;
 
+	sealNode(node);
 	return(node);
 }
 
 void freeAsgn(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
 	assert(node->stmt.type == ast_asgn);
-	freeVar(node->stmt.asgn.lhs);
-	freeNode(node->stmt.asgn.rhs);
-	free(node);
-
-	return;
+	freeNode(node);
 }
 
 /* free function for releasing all the memory assigned to a node based
 on the type. This function is called by other free* functions when
-the type of a child node is not obvious from the context */
+the type of a child node is not obvious from the context. The tree is
+walked with an explicit stack rather than by recursion, so deeply nested
+trees can be freed on threads with small stacks */
+
+static thread_local vector<astNode*> freeStack;
 
 void freeNode(astNode *node){
 	assert(node != NULL);
 
-	switch(node->type){
-		case ast_prog:{
-						freeProg(node);
-						break;
-					  }
-		case ast_func:{
-						freeFunc(node);
-						break;
-					  }
-		case ast_stmt:{
-						freeStmt(node);
-						break;
-					  }
-		case ast_extern:{
-						freeExtern(node);
-						break;
-					  }
-		case ast_var: {	
-						freeVar(node);
-						break;
-					  }
-		case ast_cnst: {
-						 freeCnst(node);
-						 break;
-					  }
-		case ast_rexpr: {
-						freeRExpr(node);
-						break;
-					  }
-		case ast_bexpr: {
-						freeBExpr(node);
-						break;
-					  }
-		case ast_uexpr: {
-						freeUExpr(node);
-						break;
-					  }
-		default: {
-					fprintf(stderr,"Incorrect node type\n");
-				 	exit(1);
-				 }
+	size_t base = freeStack.size();
+	freeStack.push_back(node);
+	while (freeStack.size() > base){
+		node = freeStack.back();
+		freeStack.pop_back();
+		forEachChild(node, [](astNode *child){
+			if (child != NULL)
+				freeStack.push_back(child);
+		});
+		if (node->type == ast_stmt && node->stmt.type == ast_block)
+			delete(node->stmt.block.stmt_list);
+		free(node);
 	}
 }
 
@@ -420,87 +522,135 @@ void freeNode(astNode *node){
 from the context */
 void freeStmt(astNode *node){
 	assert(node != NULL && node->type == ast_stmt);
-	
-	switch(node->stmt.type){
-		case ast_call: 
-						freeCall(node);
-						break;
-		case ast_ret: 
-						freeRet(node);
-						break;
-		case ast_block:
-						freeBlock(node);
-						break;
-		case ast_while:
-						freeWhile(node);
-						break;
-		case ast_if: 
-						freeIf(node);
-						break;
-		case ast_asgn:	
-						freeAsgn(node);
-						break;
-		case ast_decl:	
-						 freeDecl(node);
-						 break;
+	freeNode(node);
+}
+
+/* printNode and printStmt walk the tree with an explicit stack of lines still
+to print. An entry is either a node to print at some depth or, between the
+children of a statement, a label line such as "While: body" */
+typedef struct {
+	astNode *node;     // NULL for a label
+	const char *label;
+	int depth;
+} printItem;
+
+static thread_local vector<printItem> printStack;
+
+static void pushPrintNode(astNode *node, int n){
+	if (node != NULL)
+		printStack.push_back({node, NULL, n});
+}
+
+static void pushPrintLabel(const char *label, int n){
+	printStack.push_back({NULL, label, n});
+}
+
+/* prints the first line of a statement and pushes what follows it, last first */
+static void printStmtLine(astStmt *stmt, int n){
+	switch(stmt->type){
+		case ast_call: { 
+							printf("%*sCall: name %s\n", n, "", symbolName(stmt->call.name));
+							if (stmt->call.param != NULL){
+								printf("%*sCall: param\n", n, "");
+								pushPrintNode(stmt->call.param, n+1);
+							}
+							break;
+						}
+		case ast_ret: {
+							printf("%*sRet:\n", n, "");
+							pushPrintNode(stmt->ret.expr, n+1);
+							break;
+						}
+		case ast_block: {
+							printf("%*sBlock:\n", n, "");
+							vector<astNode*> *slist = stmt->block.stmt_list;
+							for (size_t i = slist->size(); i > 0; i--)
+								pushPrintNode(slist->at(i - 1), n+1);
+							break;
+						}
+		case ast_while: {
+							printf("%*sWhile: cond \n", n, "");
+							pushPrintNode(stmt->whilen.body, n+1);
+							pushPrintLabel("While: body ", n);
+							pushPrintNode(stmt->whilen.cond, n+1);
+							break;
+						}
+		case ast_if: {
+							printf("%*sIf: cond\n", n, "");
+							if (stmt->ifn.else_body != NULL)
+							{
+								pushPrintNode(stmt->ifn.else_body, n+1);
+								pushPrintLabel("Else: body", n);
+							}
+							pushPrintNode(stmt->ifn.if_body, n+1);
+							pushPrintLabel("If: body", n);
+							pushPrintNode(stmt->ifn.cond, n+1);
+							break;
+						}
+		case ast_asgn:	{
+							printf("%*sAsgn: lhs\n", n, "");
+							pushPrintNode(stmt->asgn.rhs, n+1);
+							pushPrintLabel("Asgn: rhs", n);
+							pushPrintNode(stmt->asgn.lhs, n+1);
+							break;
+						}
+		case ast_decl:	{
+							printf("%*sDecl: %s\n", n, "", symbolName(stmt->decl.name));
+							break;
+						}
 		default: {
 					fprintf(stderr,"Incorrect node type\n");
 				 	exit(1);
-				 };
+				 }
 	}
 }
 
-void printNode(astNode *node, int n){
-	assert(node != NULL);
-	char *indent = get_indent_str(n);
-	
+/* prints the first line of a node and pushes what follows it, last first */
+static void printNodeLine(astNode *node, int n){
 	switch(node->type){
 		case ast_prog:{
-						printf("%sProg:\n",indent);
-						printNode(node->prog.func, n+1);
+						printf("%*sProg:\n", n, "");
+						pushPrintNode(node->prog.func, n+1);
 						break;
 					  }
 		case ast_func:{
-						printf("%sFunc: %s\n",indent, node->func.name);
-						if (node->func.param != NULL)
-							printNode(node->func.param, n+1);
-
-						printNode(node->func.body, n+1);
+						printf("%*sFunc: %s\n", n, "", symbolName(node->func.name));
+						pushPrintNode(node->func.body, n+1);
+						pushPrintNode(node->func.param, n+1);
 						break;
 					  }
 		case ast_stmt:{
-						printf("%sStmt: \n",indent);
-						astStmt stmt= node->stmt;
-						printStmt(&stmt, n+1);
+						printf("%*sStmt: \n", n, "");
+						printStmtLine(&node->stmt, n+1);
 						break;
 					  }
 		case ast_extern:{
-						printf("%sExtern: %s\n", indent, node->ext.name);
+						printf("%*sExtern: %s\n", n, "", symbolName(node->ext.name));
 						break;
 					  }
 		case ast_var: {	
-						printf("%sVar: %s\n", indent, node->var.name);
+						printf("%*sVar: %s\n", n, "", symbolName(node->var.name));
 						break;
 					  }
 		case ast_cnst: {
-						printf("%sConst: %d\n", indent, node->cnst.value);
+						printf("%*sConst: %d\n", n, "", node->cnst.value);
 						 break;
 					  }
 		case ast_rexpr: {
-						printf("%sRExpr: \n", indent);
-						printNode(node->rexpr.lhs, n+1);
-						printNode(node->rexpr.rhs, n+1);
+						printf("%*sRExpr: \n", n, "");
+						pushPrintNode(node->rexpr.rhs, n+1);
+						pushPrintNode(node->rexpr.lhs, n+1);
 						break;
 					  }
 		case ast_bexpr: {
-						printf("%sBExpr: \n", indent);
-						printNode(node->bexpr.lhs, n+1);
-						printNode(node->bexpr.rhs, n+1);
+						printf("%*sBExpr: \n", n, "");
+						pushPrintNode(node->bexpr.rhs, n+1);
+						pushPrintNode(node->bexpr.lhs, n+1);
 						break;
 					  }
 		case ast_uexpr: {
-						printf("%sUExpr: \n", indent);
-						printNode(node->uexpr.expr, n+1);
+						printf("%*sUExpr: \n", n, "");
+						pushPrintNode(node->uexpr.expr, n+1);
 						break;
 					  }
 		default: {
@@ -508,71 +658,30 @@ void printNode(astNode *node, int n){
 				 	exit(1);
 				 }
 	}
-	free(indent);
+}
+
+/* prints everything pushed above base */
+static void drainPrintStack(size_t base){
+	while (printStack.size() > base){
+		printItem item = printStack.back();
+		printStack.pop_back();
+		if (item.node == NULL)
+			printf("%*s%s\n", item.depth, "", item.label);
+		else
+			printNodeLine(item.node, item.depth);
+	}
+}
+
+void printNode(astNode *node, int n){
+	assert(node != NULL);
+	size_t base = printStack.size();
+	printNodeLine(node, n);
+	drainPrintStack(base);
 }
 
 void printStmt(astStmt *stmt, int n){
 	assert(stmt != NULL);
-	char *indent = get_indent_str(n);
-
-	switch(stmt->type){
-		case ast_call: { 
-							printf("%sCall: name %s\n", indent, stmt->call.name);
-							if (stmt->call.param != NULL){
-								printf("%sCall: param\n", indent);
-								printNode(stmt->call.param, n+1);
-							}
-							break;
-						}
-		case ast_ret: {
-							printf("%sRet:\n", indent);
-							printNode(stmt->ret.expr, n+1);
-							break;
-						}
-		case ast_block: {
-							printf("%sBlock:\n", indent);
-							vector<astNode*> slist = *(stmt->block.stmt_list);
-							vector<astNode*>::iterator it = slist.begin();
-							while (it != slist.end()){
-								printNode(*it, n+1);
-								it++;
-							}
-							break;
-						}
-		case ast_while: {
-							printf("%sWhile: cond \n", indent);
-							printNode(stmt->whilen.cond, n+1);
-							printf("%sWhile: body \n", indent);
-							printNode(stmt->whilen.body, n+1);
-							break;
-						}
-		case ast_if: {
-							printf("%sIf: cond\n", indent);
-							printNode(stmt->ifn.cond, n+1);
-							printf("%sIf: body\n", indent);
-							printNode(stmt->ifn.if_body, n+1);
-							if (stmt->ifn.else_body != NULL)
-							{
-								printf("%sElse: body\n", indent);
-								printNode(stmt->ifn.else_body, n+1);
-							}
-							break;
-						}
-		case ast_asgn:	{
-							printf("%sAsgn: lhs\n", indent);
-							printNode(stmt->asgn.lhs, n+1);
-							printf("%sAsgn: rhs\n", indent);
-							printNode(stmt->asgn.rhs, n+1);
-							break;
-						}
-		case ast_decl:	{
-							printf("%sDecl: %s\n", indent, stmt->decl.name);
-							break;
-						}
-		default: {
-					fprintf(stderr,"Incorrect node type\n");
-				 	exit(1);
-				 }
-	}
-	free(indent);
+	size_t base = printStack.size();
+	printStmtLine(stmt, n);
+	drainPrintStack(base);
 }
@@ -1,7 +1,11 @@
 #ifndef AST_H
 #define AST_H 
 #include <cstddef>
+#include <cstdint>
 #include<vector>
+#include<stdio.h>
+#include<stdlib.h>
+#include "symbol.h"
 using namespace std;
 
 struct ast_Node;
@@ -61,17 +65,17 @@ typedef struct {
 	} astProg;
 
 typedef struct {
-		char* name; // name of the function
+		symbol_id name; // name of the function
 		astNode* param; // parameter, possibly NULL if the function doesn't take a param
 		astNode* body; //function body
 	} astFunc;
 
 typedef struct {
-		char* name; // For extern functions defined we will only save function names
+		symbol_id name; // For extern functions defined we will only save function names
 	} astExtern;
 
 typedef struct {
-		char* name;
+		symbol_id name;
 	} astVar; 
 
 typedef struct {
@@ -97,7 +101,7 @@ typedef struct {
 
 /* structs for different statement types */
 typedef struct {
-		char* name;
+		symbol_id name;
 		astNode* param; // For read function this field will be NULL
 	} astCall;
 
@@ -121,7 +125,7 @@ typedef struct {
 	} astIf;
 
 typedef struct {
-		char* name;
+		symbol_id name;
 	} astDecl;
 
 typedef struct {
@@ -144,6 +148,8 @@ struct ast_Stmt{
 
 struct ast_Node{
 		node_type type;
+		uint32_t size; // number of nodes in the subtree rooted here, including itself
+		uint64_t hash; // structural hash of the subtree, see setAstHashOptions
 		union {
 		  astProg   prog;
 		  astFunc   func;
@@ -161,11 +167,16 @@ struct ast_Node{
 /* 
 Declarations of create* functions for all the types of nodes 
 defined above. All the create* functions return a astNode*. 
+Names are stored as interned symbols (see symbol.h); every create* 
+that takes a name accepts either its symbol_id or its spelling.
 */
 
 astNode* createProg(astNode* extern1, astNode* extern2, astNode* func);
+astNode* createFunc(symbol_id name, astNode* param, astNode* body);
 astNode* createFunc(const char* name, astNode* param, astNode* body);
+astNode* createExtern(symbol_id name);
 astNode* createExtern(const char *name);
+astNode* createVar(symbol_id name);
 astNode* createVar(const char *name);
 astNode* createCnst(int value);
 astNode* createRExpr(astNode* lhs, astNode* rhs, rop_type op);
@@ -179,14 +190,41 @@ other create functions these functions return
 a astNode*.
 */
 
+astNode* createCall(symbol_id name, astNode *param=NULL);
 astNode* createCall(const char *name, astNode *param=NULL);
 astNode* createRet(astNode* expr);
 astNode* createBlock(vector<astNode*> *stmt_list);
 astNode* createWhile(astNode* cond, astNode* body);
 astNode* createIf(astNode* cond, astNode* if_body, astNode* else_body=NULL);
+astNode* createDecl(symbol_id decl);
 astNode* createDecl(const char* decl);
 astNode* createAsgn(astNode* lhs, astNode* rhs);
 
+/*
+Structural hashing. Every create* function fills in the node's size and a
+64-bit hash of its subtree, computed bottom-up from the node type, statement
+type, operator and the hashes of its children in order. The options choose
+whether identifier names and constant values are mixed in as well; set them
+before building trees. Two subtrees with equal hashes are, up to hash
+collisions, structurally identical under the chosen options. compareTrees
+lines up block statements by these hashes, so the options change its scores.
+*/
+
+typedef enum {
+		hash_names = 1,     // mix in identifier names (by spelling, so hashes are stable across runs)
+		hash_constants = 2, // mix in constant values
+		hash_canonical = 4  // hash (and compare) trees in the canonical form of canonicalizeTree, see canonical.h
+	} hash_option;
+
+void setAstHashOptions(unsigned options); // bitwise or of hash_option, default both
+unsigned getAstHashOptions();
+
+/* Recomputes size and hash for every node under root, e.g. after the tree was edited in place */
+void rehashTree(astNode* root);
+
+/* Recomputes size and hash of node alone, from its fields and the (up to date) sizes and hashes of its children */
+void rehashNode(astNode* node);
+
 /* 
 Declarations for all free* functions. All these functions take a astNode* as parameter
 as free the memory allocated by corresponding create functions.
@@ -221,4 +259,71 @@ void freeStmt(astNode*);
 void printNode(astNode*, int indent=0);
 void printStmt(astStmt*, int indent=0);
 
+/* Calls visit on every child slot of node in source order, NULL children included.
+Used by the passes that walk a tree with their own stack */
+template <typename Visit>
+void forEachChild(astNode *node, Visit visit){
+	switch(node->type){
+		case ast_prog:
+			visit(node->prog.ext1);
+			visit(node->prog.ext2);
+			visit(node->prog.func);
+			break;
+		case ast_func:
+			visit(node->func.param);
+			visit(node->func.body);
+			break;
+		case ast_rexpr:
+			visit(node->rexpr.lhs);
+			visit(node->rexpr.rhs);
+			break;
+		case ast_bexpr:
+			visit(node->bexpr.lhs);
+			visit(node->bexpr.rhs);
+			break;
+		case ast_uexpr:
+			visit(node->uexpr.expr);
+			break;
+		case ast_extern:
+		case ast_var:
+		case ast_cnst:
+			break;
+		case ast_stmt:
+			switch(node->stmt.type){
+				case ast_call:
+					visit(node->stmt.call.param);
+					break;
+				case ast_ret:
+					visit(node->stmt.ret.expr);
+					break;
+				case ast_block:
+					for (astNode *child : *(node->stmt.block.stmt_list))
+						visit(child);
+					break;
+				case ast_while:
+					visit(node->stmt.whilen.cond);
+					visit(node->stmt.whilen.body);
+					break;
+				case ast_if:
+					visit(node->stmt.ifn.cond);
+					visit(node->stmt.ifn.if_body);
+					visit(node->stmt.ifn.else_body);
+					break;
+				case ast_asgn:
+					visit(node->stmt.asgn.lhs);
+					visit(node->stmt.asgn.rhs);
+					break;
+				case ast_decl:
+					break;
+				default:
+					fprintf(stderr,"Incorrect node type\n");
+					exit(1);
+			}
+			break;
+		default:
+			fprintf(stderr,"Incorrect node type\n");
+			exit(1);
+	}
+}
+
 #endif
@@ -0,0 +1,78 @@
+/*
+*   MiniC Compiler - AST Arena
+*
+*   Purpose: Every create* function used to make its own calloc for the node, and freeNode walked the whole tree to
+*   free each piece again. With thousands of retained ASTs that is millions of small allocations spread over the
+*   heap. The arena hands out nodes from large contiguous chunks and throws everything away with a single reset().
+*/
+
+#include <stdlib.h>
+#include <cstddef>
+#include <new>
+#include "ast_arena.h"
+
+static thread_local AstArena* activeArena = NULL;
+
+// aligned like malloc so anything create* stores can live in a chunk
+static const size_t ARENA_ALIGN = alignof(max_align_t);
+
+AstArena::AstArena(size_t chunkSize)
+    : chunkSize(chunkSize), cursor(NULL), limit(NULL), used(0) {
+}
+
+AstArena::~AstArena() {
+    reset();
+}
+
+void AstArena::newChunk(size_t minSize) {
+    size_t size = minSize > chunkSize ? minSize : chunkSize;
+    char* chunk = (char*) calloc(1, size);
+    if (chunk == NULL) {
+        throw std::bad_alloc();
+    }
+    chunks.push_back(chunk);
+    cursor = chunk;
+    limit = chunk + size;
+}
+
+void* AstArena::allocate(size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (cursor == NULL || (size_t) (limit - cursor) < size) {
+        newChunk(size);
+    }
+    // chunks come from calloc and are never reused before reset(), so the memory is already zeroed
+    void* result = cursor;
+    cursor += size;
+    used += size;
+    return result;
+}
+
+void AstArena::adoptList(vector<astNode*>* list) {
+    lists.push_back(list);
+}
+
+void AstArena::reset() {
+    for (vector<astNode*>* list : lists) {
+        delete list;
+    }
+    lists.clear();
+    for (char* chunk : chunks) {
+        free(chunk);
+    }
+    chunks.clear();
+    cursor = NULL;
+    limit = NULL;
+    used = 0;
+}
+
+AstArenaScope::AstArenaScope(AstArena& arena) : previous(activeArena) {
+    activeArena = &arena;
+}
+
+AstArenaScope::~AstArenaScope() {
+    activeArena = previous;
+}
+
+AstArena* currentAstArena() {
+    return activeArena;
+}
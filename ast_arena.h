@@ -0,0 +1,66 @@
+/*
+* h file for ast_arena.cpp
+*
+* An AstArena is a bump allocator for one AST. While an AstArenaScope is active
+* on a thread, every create* function in ast.c takes its node from the arena
+* instead of calling calloc, and the whole tree is released at once with reset().
+* Names are interned process-wide (see symbol.h), so nodes only hold their ids.
+*
+* A tree built inside an arena must never be passed to freeNode.
+*/
+
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+#include <cstddef>
+#include <vector>
+#include "ast.h"
+
+class AstArena {
+public:
+    explicit AstArena(size_t chunkSize = 64 * 1024);
+    ~AstArena();
+
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    // Returns size bytes of zeroed memory aligned for any AST struct
+    void* allocate(size_t size);
+
+    // Takes ownership of a block's statement list so reset() can delete it with the tree
+    void adoptList(vector<astNode*>* list);
+
+    // Releases every node and statement list allocated from this arena
+    void reset();
+
+    size_t chunkCount() const { return chunks.size(); }
+    size_t bytesUsed() const { return used; }
+
+private:
+    void newChunk(size_t minSize);
+
+    size_t chunkSize;
+    std::vector<char*> chunks;
+    char* cursor;
+    char* limit;
+    size_t used;
+    std::vector<vector<astNode*>*> lists;
+};
+
+// Routes the create* calls made on this thread to arena for the lifetime of the scope
+class AstArenaScope {
+public:
+    explicit AstArenaScope(AstArena& arena);
+    ~AstArenaScope();
+
+    AstArenaScope(const AstArenaScope&) = delete;
+    AstArenaScope& operator=(const AstArenaScope&) = delete;
+
+private:
+    AstArena* previous;
+};
+
+// The arena create* should allocate from on this thread, or NULL for plain calloc
+AstArena* currentAstArena();
+
+#endif
@@ -0,0 +1,272 @@
+/*
+*   MiniC Compiler - AST Cache
+*
+*   Purpose: The same submissions are rescored many times as new ones arrive, and every run used to lex and parse all
+*   of them again. This file keeps the flattened tree and fingerprints of every successfully parsed file in a cache
+*   directory, keyed by a hash of the file's contents, so unchanged files cost one file read on later runs.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <unordered_map>
+#include "ast_cache.h"
+#include "fingerprint.h"
+#include "metrics.h"
+#include "symbol.h"
+
+static const char CACHE_MAGIC[4] = {'M', 'C', 'A', 'C'};
+
+// Fixed-size start of every entry. The arrays follow in the order they are listed here
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;              // content hash of the source file
+    uint32_t hashOptions;      // getAstHashOptions() when the subtree hashes were computed
+    uint32_t kgram;            // fingerprint parameters
+    uint32_t window;
+    uint32_t nodeCount;        // hash[], childCount[], size[], value[], kind[], op[]
+    uint32_t fingerprintCount; // fingerprints[]
+    uint32_t nameCount;        // NUL-terminated spellings, indexed by the value of named nodes
+    uint32_t nameBytes;
+    uint32_t reserved;
+};
+
+// total entry size for a header, or 0 if the counts overflow
+static size_t entrySize(const CacheHeader& header) {
+    uint64_t n = header.nodeCount;
+    uint64_t size = sizeof(CacheHeader) + n * (sizeof(uint64_t) + 3 * sizeof(uint32_t) + 2 * sizeof(uint8_t)) +
+                    (uint64_t) header.fingerprintCount * sizeof(uint64_t) + header.nameBytes;
+    return size > (uint64_t) SIZE_MAX ? 0 : (size_t) size;
+}
+
+// entries made under different hash options sit side by side instead of evicting each other
+static std::string entryPath(const std::string& dir, uint64_t key) {
+    char name[40];
+    snprintf(name, sizeof(name), "%016llx-%u.ast", (unsigned long long) key, getAstHashOptions());
+    return dir + "/" + name;
+}
+
+// FNV-1a over the bytes, finished with the length so that trailing NULs still count
+const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+static uint64_t hashBytes(uint64_t hash, const unsigned char* bytes, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t finishHash(uint64_t hash, uint64_t length) {
+    hash ^= length;
+    hash *= FNV_PRIME;
+    return hash;
+}
+
+bool hashFileContents(const char* path, uint64_t& key) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    uint64_t hash = FNV_OFFSET;
+    uint64_t length = 0;
+    unsigned char buffer[16384];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        hash = hashBytes(hash, buffer, got);
+        length += got;
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    METRIC_COUNT(counter_bytes_read, length);
+    key = finishHash(hash, length);
+    return ok;
+}
+
+uint64_t hashContents(const char* data, size_t size) {
+    return finishHash(hashBytes(FNV_OFFSET, (const unsigned char*) data, size), size);
+}
+
+// copies count elements out of the entry buffer and advances the cursor
+template <typename T>
+static void readArray(const char*& cursor, std::vector<T>& out, size_t count) {
+    out.resize(count);
+    if (count > 0) {
+        memcpy(out.data(), cursor, count * sizeof(T));
+    }
+    cursor += count * sizeof(T);
+}
+
+template <typename T>
+static void writeArray(std::string& out, const std::vector<T>& in) {
+    if (!in.empty()) {
+        out.append((const char*) in.data(), in.size() * sizeof(T));
+    }
+}
+
+// true if header starts a usable entry for key of entryBytes bytes
+static bool usableHeader(const CacheHeader& header, uint64_t key, size_t entryBytes) {
+    return memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header.version == AST_CACHE_VERSION &&
+           header.key == key && header.hashOptions == getAstHashOptions() && header.kgram == FINGERPRINT_KGRAM &&
+           header.window == FINGERPRINT_WINDOW && entrySize(header) == entryBytes;
+}
+
+bool loadCachedTree(const std::string& dir, uint64_t key, FlatAst& tree, std::vector<uint64_t>& fingerprints) {
+    int fd = open(entryPath(dir, key).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    std::vector<char> buffer;
+    bool ok = fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(CacheHeader);
+    if (ok) {
+        buffer.resize(st.st_size);
+        ok = read(fd, buffer.data(), buffer.size()) == (ssize_t) buffer.size();
+    }
+    close(fd);
+    if (!ok) {
+        return false;
+    }
+    METRIC_COUNT(counter_bytes_read, buffer.size());
+
+    CacheHeader header;
+    memcpy(&header, buffer.data(), sizeof(header));
+    if (!usableHeader(header, key, buffer.size())) {
+        return false;
+    }
+
+    FlatAst loaded;
+    std::vector<uint64_t> loadedFingerprints;
+    const char* cursor = buffer.data() + sizeof(header);
+    readArray(cursor, loaded.hash, header.nodeCount);
+    readArray(cursor, loadedFingerprints, header.fingerprintCount);
+    readArray(cursor, loaded.childCount, header.nodeCount);
+    readArray(cursor, loaded.size, header.nodeCount);
+    readArray(cursor, loaded.value, header.nodeCount);
+    readArray(cursor, loaded.kind, header.nodeCount);
+    readArray(cursor, loaded.op, header.nodeCount);
+    if (!isWellFormed(loaded)) {
+        return false;
+    }
+
+    // intern the spellings and turn name indices back into this run's symbol ids
+    std::vector<symbol_id> names;
+    const char* end = buffer.data() + buffer.size();
+    while (cursor < end && names.size() < header.nameCount) {
+        size_t len = strnlen(cursor, end - cursor);
+        if (cursor + len == end) {
+            return false;
+        }
+        names.push_back(internSymbol(cursor, len));
+        cursor += len + 1;
+    }
+    if (names.size() != header.nameCount || cursor != end) {
+        return false;
+    }
+    for (uint32_t i = 0; i < loaded.nodeCount(); i++) {
+        if (isFlatNamed(loaded.kind[i])) {
+            if ((uint32_t) loaded.value[i] >= names.size()) {
+                return false;
+            }
+            loaded.value[i] = (int32_t) names[loaded.value[i]];
+        }
+    }
+
+    tree = std::move(loaded);
+    fingerprints = std::move(loadedFingerprints);
+    return true;
+}
+
+bool loadCachedFingerprints(const std::string& dir, uint64_t key, std::vector<uint64_t>& fingerprints) {
+    int fd = open(entryPath(dir, key).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    CacheHeader header;
+    std::vector<uint64_t> loaded;
+    bool ok = fstat(fd, &st) == 0 && pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header) &&
+              usableHeader(header, key, st.st_size);
+    if (ok) {
+        // the fingerprints follow the subtree hashes
+        loaded.resize(header.fingerprintCount);
+        size_t bytes = loaded.size() * sizeof(uint64_t);
+        off_t offset = sizeof(header) + (off_t) header.nodeCount * sizeof(uint64_t);
+        ok = bytes == 0 || pread(fd, loaded.data(), bytes, offset) == (ssize_t) bytes;
+        METRIC_COUNT(counter_bytes_read, sizeof(header) + bytes);
+    }
+    close(fd);
+    if (ok) {
+        fingerprints = std::move(loaded);
+    }
+    return ok;
+}
+
+bool storeCachedTree(const std::string& dir, uint64_t key, const FlatAst& tree,
+                     const std::vector<uint64_t>& fingerprints) {
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    // named nodes store an index into the entry's own spelling table
+    FlatAst stored = tree;
+    std::unordered_map<int32_t, int32_t> nameIndex;
+    std::string spellings;
+    for (uint32_t i = 0; i < stored.nodeCount(); i++) {
+        if (!isFlatNamed(stored.kind[i])) {
+            continue;
+        }
+        auto found = nameIndex.find(stored.value[i]);
+        if (found == nameIndex.end()) {
+            found = nameIndex.emplace(stored.value[i], (int32_t) nameIndex.size()).first;
+            spellings += symbolName((symbol_id) stored.value[i]);
+            spellings += '\0';
+        }
+        stored.value[i] = found->second;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = AST_CACHE_VERSION;
+    header.key = key;
+    header.hashOptions = getAstHashOptions();
+    header.kgram = FINGERPRINT_KGRAM;
+    header.window = FINGERPRINT_WINDOW;
+    header.nodeCount = stored.nodeCount();
+    header.fingerprintCount = (uint32_t) fingerprints.size();
+    header.nameCount = (uint32_t) nameIndex.size();
+    header.nameBytes = (uint32_t) spellings.size();
+
+    std::string entry((const char*) &header, sizeof(header));
+    entry.reserve(entrySize(header));
+    writeArray(entry, stored.hash);
+    writeArray(entry, fingerprints);
+    writeArray(entry, stored.childCount);
+    writeArray(entry, stored.size);
+    writeArray(entry, stored.value);
+    writeArray(entry, stored.kind);
+    writeArray(entry, stored.op);
+    entry += spellings;
+
+    std::string temp = dir + "/.entry-XXXXXX";
+    int fd = mkstemp(&temp[0]);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, entry.data(), entry.size()) == (ssize_t) entry.size();
+    ok = close(fd) == 0 && ok;
+    if (ok) {
+        ok = rename(temp.c_str(), entryPath(dir, key).c_str()) == 0;
+    }
+    if (!ok) {
+        unlink(temp.c_str());
+    }
+    return ok;
+}
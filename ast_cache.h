@@ -0,0 +1,58 @@
+/*
+* h file for ast_cache.cpp
+*
+* An on-disk cache of parsed submissions. Each entry holds the flattened AST
+* and the fingerprints of one source file and is named after a hash of the
+* file's contents, so an unchanged file is found again however it was renamed
+* and an edited one simply misses. Identifiers are stored by spelling and
+* re-interned on load, because symbol ids are only meaningful inside one run.
+*
+* Every entry starts with a magic number and AST_CACHE_VERSION; entries with
+* another version, with subtree hashes computed under other hash options, or
+* that fail validation are treated as misses. Entries are in native byte order.
+*/
+
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "flat_ast.h"
+
+// bump whenever the entry layout or anything stored in it (flattening, hashing, fingerprints) changes
+const uint32_t AST_CACHE_VERSION = 1;
+
+/**
+ * Hashes the contents of the file at path.
+ * returns: false if the file could not be read.
+ */
+bool hashFileContents(const char* path, uint64_t& key);
+
+// The key hashFileContents gives a file holding the size bytes at data
+uint64_t hashContents(const char* data, size_t size);
+
+/**
+ * Loads the entry for key from dir with a single read.
+ * returns: false, leaving tree and fingerprints untouched, if there is no usable entry.
+ */
+bool loadCachedTree(const std::string& dir, uint64_t key, FlatAst& tree, std::vector<uint64_t>& fingerprints);
+
+/**
+ * Loads only the fingerprints of the entry for key from dir, reading the header and the
+ * fingerprint array and nothing else, for callers that have to look at many entries to find the
+ * few trees they need.
+ * returns: false, leaving fingerprints untouched, if there is no usable entry.
+ */
+bool loadCachedFingerprints(const std::string& dir, uint64_t key, std::vector<uint64_t>& fingerprints);
+
+/**
+ * Writes the entry for key into dir, creating dir if needed. The entry is written to a
+ * temporary file and renamed into place, so concurrent readers never see half an entry.
+ * returns: false if the entry could not be written.
+ */
+bool storeCachedTree(const std::string& dir, uint64_t key, const FlatAst& tree,
+                     const std::vector<uint64_t>& fingerprints);
+
+#endif
@@ -0,0 +1,730 @@
+/*
+*   MiniC Compiler - Batch Comparison
+*
+*   Purpose: Scoring a class of N submissions pair by pair means N^2 process launches, each of which re-lexes and
+*   re-parses both of its files. This file parses every submission exactly once, keeps the resulting ASTs around
+*   and runs compareTrees over all pairs in one pass, producing a score matrix. Loading is a pipeline of reader,
+*   parser and analysis threads joined by bounded queues, so the disk is read while earlier files are parsed.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ast.h"
+#include "ast_cache.h"
+#include "batch.h"
+#include "bounded_queue.h"
+#include "canonical.h"
+#include "fingerprint.h"
+#include "minhash.h"
+#include "inclass.h"
+#include "logging.h"
+#include "metrics.h"
+#include "parser.h"
+#include "thread_pool.h"
+#include "tree_edit.h"
+
+// Logs and reports the errors of parsing path. A failed parse leaves nothing in arena
+static astNode* finishParse(const char* path, const ParseDiagnostics& diag, astNode* root, AstArena* arena) {
+    for (const Diagnostic& error : diag.errors) {
+        LOG_WARN("%s: %s", path, formatDiagnostic(error).c_str());
+        reportDiagnostic(path, error);
+    }
+    if (root == NULL) {
+        LOG_ERROR("Parse error: %s", path);
+        if (arena != NULL) {
+            arena->reset();
+        }
+        return NULL;
+    }
+    // the semantic checks ran during the parse, their errors are among diag.errors
+    if (getAstHashOptions() & hash_canonical) {
+        canonicalizeTree(root);
+    }
+    return root;
+}
+
+astNode* parseSubmission(const char* path, AstArena* arena) {
+    ParseDiagnostics diag;
+    astNode* root;
+    if (arena != NULL) {
+        AstArenaScope scope(*arena);
+        root = parseFile(path, diag);
+    } else {
+        root = parseFile(path, diag);
+    }
+    return finishParse(path, diag, root, arena);
+}
+
+// returns true if name ends in ".c"
+static bool isMiniCFile(const char* name) {
+    size_t len = strlen(name);
+    return len > 2 && strcmp(name + len - 2, ".c") == 0;
+}
+
+bool collectSubmissionPaths(const char* source, std::vector<std::string>& paths) {
+    struct stat st;
+    if (stat(source, &st) != 0) {
+        fprintf(stderr, "Cannot access %s\n", source);
+        return false;
+    }
+
+    // a directory: take every regular MiniC file inside it
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(source);
+        if (dir == NULL) {
+            fprintf(stderr, "Cannot open directory %s\n", source);
+            return false;
+        }
+        std::vector<std::string> found;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.' || !isMiniCFile(entry->d_name)) {
+                continue;
+            }
+            std::string full = std::string(source) + "/" + entry->d_name;
+            struct stat fst;
+            if (stat(full.c_str(), &fst) == 0 && S_ISREG(fst.st_mode)) {
+                found.push_back(full);
+            }
+        }
+        closedir(dir);
+        // sort so that matrix rows are stable across runs
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+        return true;
+    }
+
+    // otherwise a list file with one path per line
+    FILE* list = fopen(source, "r");
+    if (list == NULL) {
+        fprintf(stderr, "Cannot open file list %s\n", source);
+        return false;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), list) != NULL) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len > 0) {
+            paths.push_back(line);
+        }
+    }
+    fclose(list);
+    return true;
+}
+
+// One submission on its way through the load pipeline. The stages hand each other indices into a vector of
+// these, so only the bytes of the files between the read and parse stages take up memory in the queues
+struct LoadItem {
+    std::string source;   // the file's contents, from the read stage until it is parsed
+    FlatAst flat;         // the cache entry's tree, or the parsed tree once flattened
+    bool readable = false;
+    bool cached = false;  // flat and the fingerprints came from the cache
+};
+
+// Reads the whole file at path into contents; returns false if it cannot be read
+static bool readSourceFile(const char* path, std::string& contents) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    contents.resize(st.st_size);
+    size_t done = 0;
+    while (done < contents.size()) {
+        ssize_t got = read(fd, &contents[done], contents.size() - done);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        done += got;
+    }
+    close(fd);
+    // a file that shrank while being read is parsed as far as it got
+    contents.resize(done);
+    return true;
+}
+
+// Read stage: the file's bytes and, with a cache directory, its key and cache entry. A cached
+// submission's bytes are dropped right away, it is not parsed
+static void readSubmission(Submission& sub, LoadItem& item, const BatchOptions& options) {
+    METRIC_PHASE(phase_read);
+    item.readable = readSourceFile(sub.path.c_str(), item.source);
+    if (!item.readable) {
+        return;
+    }
+    METRIC_COUNT(counter_bytes_read, item.source.size());
+    if (!options.cacheDir.empty()) {
+        sub.key = hashContents(item.source.data(), item.source.size());
+        if (loadCachedTree(options.cacheDir, sub.key, item.flat, sub.fingerprints)) {
+            item.cached = true;
+            std::string().swap(item.source);
+        }
+    }
+}
+
+// Parse stage: the pointer tree, parsed from the bytes read or rebuilt from the cache entry
+static void parseLoadedSource(Submission& sub, LoadItem& item, const BatchOptions& options) {
+    if (item.cached) {
+        if (!options.flat) {
+            AstArenaScope scope(*sub.arena);
+            sub.root = unflattenTree(item.flat);
+        }
+        return;
+    }
+    ParseDiagnostics diag;
+    astNode* root = NULL;
+    if (item.readable) {
+        AstArenaScope scope(*sub.arena);
+        root = parseSource(item.source.data(), item.source.size(), diag);
+    } else {
+        diag.errors.push_back({diag_io, 0, "cannot open " + sub.path});
+    }
+    std::string().swap(item.source);
+    sub.root = finishParse(sub.path.c_str(), diag, root, sub.arena.get());
+}
+
+// Analysis stage: derives the forms the run needs from the tree and adds a cache entry for a parsed file. Only
+// those forms are kept
+static void analyzeSubmission(Submission& sub, LoadItem& item, const BatchOptions& options) {
+    METRIC_PHASE(phase_load);
+    bool caching = !options.cacheDir.empty();
+    bool keepFlat = options.flat || options.scorer == scorer_ted || options.packing;
+    bool keepFingerprints = options.prunes() || options.packing;
+
+    if (!item.cached) {
+        if (sub.root == NULL) {
+            return;
+        }
+        if (keepFlat || keepFingerprints || caching) {
+            flattenTree(sub.root, item.flat);
+        }
+        if (keepFingerprints || caching) {
+            sub.fingerprints = fingerprintTree(item.flat);
+        }
+        if (caching && !storeCachedTree(options.cacheDir, sub.key, item.flat, sub.fingerprints)) {
+            fprintf(stderr, "Cannot write cache entry for %s\n", sub.path.c_str());
+        }
+        if (options.flat) {
+            // the flat copy is all the scorer needs, so the pointer tree is dropped right away
+            sub.arena->reset();
+            sub.root = NULL;
+        }
+    }
+
+    if (options.lshLength > 0) {
+        sub.signature = minHashSignature(sub.fingerprints, options.lshLength);
+    }
+    if (!keepFingerprints) {
+        std::vector<uint64_t>().swap(sub.fingerprints);
+    }
+    if (keepFlat) {
+        sub.flat = std::move(item.flat);
+    }
+    if (options.scorer == scorer_ted) {
+        buildEditTree(sub.flatTree(), sub.editTree);
+    }
+}
+
+// Fills in one submission from the cache entry for sub.key; a missing entry leaves it empty
+static void loadCachedSubmission(Submission& sub, const BatchOptions& options) {
+    LoadItem item;
+    if (!loadCachedTree(options.cacheDir, sub.key, item.flat, sub.fingerprints)) {
+        return;
+    }
+    item.cached = true;
+    parseLoadedSource(sub, item, options);
+    analyzeSubmission(sub, item, options);
+}
+
+// Starts count threads running stage
+template <typename Stage>
+static void startStage(std::vector<std::thread>& threads, unsigned count, const Stage& stage) {
+    for (unsigned i = 0; i < count; i++) {
+        threads.emplace_back(stage);
+    }
+}
+
+std::vector<Submission> loadSubmissions(const std::vector<std::string>& paths, const BatchOptions& options) {
+    unsigned parsers = options.threads;
+    if (parsers == 0) {
+        parsers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    unsigned analyzers = std::max(1u, parsers / 2);
+    unsigned readers = std::max(1u, options.readers);
+    size_t depth = options.queueDepth > 0 ? options.queueDepth : 2 * (size_t) parsers;
+
+    std::vector<Submission> loaded(paths.size());
+    std::vector<LoadItem> items(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        loaded[i].path = paths[i];
+        loaded[i].arena.reset(new AstArena());
+    }
+
+    // read -> parse -> analyze -> this thread. Every queue is bounded, so a stage that runs ahead
+    // blocks until the next one catches up: at most depth files wait between the reader and parser
+    // threads, and the memory held by source text stays the same however many files there are
+    BoundedQueue<size_t> readQueue(depth, readers);
+    BoundedQueue<size_t> parseQueue(depth, parsers);
+    BoundedQueue<size_t> doneQueue(depth, analyzers);
+    std::atomic<size_t> nextPath(0);
+    std::vector<std::thread> threads;
+    startStage(threads, readers, [&]() {
+        size_t i;
+        while ((i = nextPath.fetch_add(1)) < paths.size()) {
+            readSubmission(loaded[i], items[i], options);
+            readQueue.push(i);
+        }
+        readQueue.producerDone();
+    });
+    startStage(threads, parsers, [&]() {
+        size_t i;
+        while (readQueue.pop(i)) {
+            parseLoadedSource(loaded[i], items[i], options);
+            parseQueue.push(i);
+        }
+        parseQueue.producerDone();
+    });
+    startStage(threads, analyzers, [&]() {
+        size_t i;
+        while (parseQueue.pop(i)) {
+            analyzeSubmission(loaded[i], items[i], options);
+            doneQueue.push(i);
+        }
+        doneQueue.producerDone();
+    });
+
+    // the sink: files finish out of order, so each one is registered once everything before it has been,
+    // which keeps the input order
+    std::vector<Submission> subs;
+    subs.reserve(paths.size());
+    std::vector<bool> finished(paths.size(), false);
+    size_t next = 0;
+    size_t i;
+    while (doneQueue.pop(i)) {
+        finished[i] = true;
+        for (; next < paths.size() && finished[next]; next++) {
+            Submission& sub = loaded[next];
+            if (!sub.loaded()) {
+                fprintf(stderr, "Skipping %s\n", sub.path.c_str());
+                continue;
+            }
+            subs.push_back(std::move(sub));
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return subs;
+}
+
+std::vector<Submission> loadCachedSubmissions(const std::vector<std::string>& paths, const std::vector<uint64_t>& keys,
+                                              const BatchOptions& options) {
+    std::vector<Submission> subs(paths.size());
+    WorkStealingPool pool(options.threads);
+    for (size_t i = 0; i < paths.size(); i++) {
+        Submission& sub = subs[i];
+        sub.path = paths[i];
+        sub.key = keys[i];
+        sub.arena.reset(new AstArena());
+        pool.submit([&sub, &options](unsigned) {
+            loadCachedSubmission(sub, options);
+        });
+    }
+    pool.wait();
+    return subs;
+}
+
+std::vector<Submission> loadCorpus(const CorpusMapping& corpus, const BatchOptions& options) {
+    std::vector<Submission> subs;
+    subs.reserve(corpus.size());
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (!corpus.checkTree(i)) {
+            fprintf(stderr, "Skipping %s\n", corpus.path(i));
+            continue;
+        }
+        subs.emplace_back();
+        Submission& sub = subs.back();
+        sub.path = corpus.path(i);
+        sub.root = NULL;
+        sub.mapped = corpus.tree(i);
+        if (options.scorer == scorer_ted) {
+            buildEditTree(sub.mapped, sub.editTree);
+        }
+        if (options.prunes()) {
+            const uint64_t* fingerprints = corpus.fingerprints(i);
+            sub.fingerprints.assign(fingerprints, fingerprints + corpus.fingerprintCount(i));
+            if (options.lshLength > 0) {
+                sub.signature = minHashSignature(sub.fingerprints, options.lshLength);
+            }
+        }
+    }
+    return subs;
+}
+
+std::vector<Submission> loadCorpusQuery(const CorpusMapping& corpus, const char* queryPath,
+                                        const BatchOptions& options) {
+    std::vector<Submission> query = loadSubmissions(std::vector<std::string>(1, queryPath), options);
+    if (query.empty()) {
+        return query;
+    }
+    // the candidates are compared with a parsed tree, so they are copied out with their names as symbol ids
+    std::vector<Submission> subs;
+    for (uint32_t hit : corpus.lshIndex().query(query[0].signature)) {
+        if (!corpus.checkTree(hit)) {
+            fprintf(stderr, "Skipping %s\n", corpus.path(hit));
+            continue;
+        }
+        subs.emplace_back();
+        Submission& sub = subs.back();
+        sub.path = corpus.path(hit);
+        corpus.copyTree(hit, sub.flat);
+        if (options.scorer == scorer_ted) {
+            buildEditTree(sub.flat, sub.editTree);
+        }
+    }
+    subs.push_back(std::move(query[0]));
+    return subs;
+}
+
+// side length of the square tiles the pair matrix is cut into; one tile is one pool task
+const size_t PAIR_TILE = 32;
+
+static int scorePair(const Submission& sub1, const Submission& sub2, const BatchOptions& options) {
+    METRIC_COUNT(counter_pairs_scored, 1);
+    if (options.scorer == scorer_ted) {
+        return treeEditScore(sub1.flatTree(), sub1.editTree, sub2.flatTree(), sub2.editTree, options.editCosts);
+    }
+    if (options.flat) {
+        return compareFlatTrees(sub1.flatTree(), sub2.flatTree());
+    }
+    return compareTrees(sub1.root, sub2.root);
+}
+
+// scorePair, except that heuristic scores below minScore are given up on early and only bounded from above.
+// The edit distance is always computed in full
+static int scorePairBounded(const Submission& sub1, const Submission& sub2, const BatchOptions& options, int minScore) {
+    METRIC_COUNT(counter_pairs_scored, 1);
+    if (options.scorer == scorer_ted) {
+        return treeEditScore(sub1.flatTree(), sub1.editTree, sub2.flatTree(), sub2.editTree, options.editCosts);
+    }
+    if (options.flat) {
+        return compareFlatTreesBounded(sub1.flatTree(), sub2.flatTree(), minScore);
+    }
+    return compareTreesBounded(sub1.root, sub2.root, minScore);
+}
+
+// Scores every pair (i, j) with i <= j that falls inside tile (rowTile, colTile)
+static void scoreTile(const std::vector<Submission>& subs, const BatchOptions& options, std::vector<int>& scores,
+                      size_t rowTile, size_t colTile) {
+    METRIC_PHASE(phase_compare);
+    size_t n = subs.size();
+    size_t rowEnd = std::min(n, (rowTile + 1) * PAIR_TILE);
+    size_t colEnd = std::min(n, (colTile + 1) * PAIR_TILE);
+    for (size_t i = rowTile * PAIR_TILE; i < rowEnd; i++) {
+        for (size_t j = std::max(i, colTile * PAIR_TILE); j < colEnd; j++) {
+            int score = scorePair(subs[i], subs[j], options);
+            scores[i * n + j] = score;
+            scores[j * n + i] = score;
+        }
+    }
+}
+
+std::vector<int> scoreAllPairs(const std::vector<Submission>& subs, const BatchOptions& options) {
+    size_t n = subs.size();
+    std::vector<int> scores(n * n);
+    // both scorers are symmetric, so only tiles on or above the diagonal are scored. Every cell belongs to
+    // exactly one tile (or its mirror), so workers write the preallocated matrix without any locking
+    size_t tiles = (n + PAIR_TILE - 1) / PAIR_TILE;
+    WorkStealingPool pool(options.threads);
+    for (size_t rowTile = 0; rowTile < tiles; rowTile++) {
+        for (size_t colTile = rowTile; colTile < tiles; colTile++) {
+            pool.submit([&subs, &options, &scores, rowTile, colTile](unsigned) {
+                scoreTile(subs, options, scores, rowTile, colTile);
+            });
+        }
+    }
+    pool.wait();
+    return scores;
+}
+
+// a fingerprint found in more than this fraction of the submissions is boilerplate and not used for matching
+const double MAX_FINGERPRINT_SHARE = 0.1;
+
+// corpora smaller than this keep every fingerprint; the boilerplate cut only pays off on large batches
+const size_t MIN_DOCS_FOR_CUTOFF = 200;
+
+// pairs handed to one pool task when scoring candidates
+const size_t PAIR_CHUNK = 256;
+
+// the document frequency above which a fingerprint counts as boilerplate in a batch of n, 0 for none
+static size_t maxDocFrequency(size_t n) {
+    return n >= MIN_DOCS_FOR_CUTOFF ? (size_t) (MAX_FINGERPRINT_SHARE * n) : 0;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> findCandidatePairs(const std::vector<Submission>& subs,
+                                                              const BatchOptions& options) {
+    if (options.lshLength > 0) {
+        LshIndex lsh(options.lshLength, options.lshBands);
+        for (const Submission& sub : subs) {
+            lsh.add(sub.signature);
+        }
+        return lsh.candidatePairs();
+    }
+
+    FingerprintIndex index;
+    for (size_t i = 0; i < subs.size(); i++) {
+        index.add((uint32_t) i, subs[i].fingerprints);
+    }
+    return index.candidatePairs(options.minOverlap, maxDocFrequency(subs.size()), options.threads);
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> findNewCandidatePairs(const std::vector<Submission>& subs, size_t firstNew,
+                                                                 const BatchOptions& options) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    if (options.lshLength > 0) {
+        LshIndex lsh(options.lshLength, options.lshBands);
+        for (const Submission& sub : subs) {
+            lsh.add(sub.signature);
+        }
+        for (size_t j = firstNew; j < subs.size(); j++) {
+            for (uint32_t hit : lsh.query(subs[j].signature)) {
+                if (hit < j) {
+                    pairs.push_back(std::make_pair(hit, (uint32_t) j));
+                }
+            }
+        }
+        return pairs;
+    }
+
+    FingerprintIndex index;
+    for (size_t i = 0; i < subs.size(); i++) {
+        index.add((uint32_t) i, subs[i].fingerprints);
+    }
+    for (size_t j = firstNew; j < subs.size(); j++) {
+        for (uint32_t i : index.candidatesBefore((uint32_t) j, options.minOverlap, maxDocFrequency(subs.size()))) {
+            pairs.push_back(std::make_pair(i, (uint32_t) j));
+        }
+    }
+    return pairs;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> findQueryCandidates(const std::vector<Submission>& subs, size_t query,
+                                                               const BatchOptions& options) {
+    LshIndex lsh(options.lshLength, options.lshBands);
+    std::vector<uint32_t> indexed; // LSH id -> submission index
+    for (size_t i = 0; i < subs.size(); i++) {
+        if (i != query) {
+            lsh.add(subs[i].signature);
+            indexed.push_back((uint32_t) i);
+        }
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t hit : lsh.query(subs[query].signature)) {
+        pairs.push_back(std::make_pair(indexed[hit], (uint32_t) query));
+    }
+    return pairs;
+}
+
+std::vector<ScoredPair> scoreCandidatePairs(const std::vector<Submission>& subs,
+                                            const std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+                                            const BatchOptions& options) {
+    std::vector<ScoredPair> scores(pairs.size());
+    WorkStealingPool pool(options.threads);
+    for (size_t first = 0; first < pairs.size(); first += PAIR_CHUNK) {
+        pool.submit([&subs, &pairs, &options, &scores, first](unsigned) {
+            METRIC_PHASE(phase_compare);
+            size_t last = std::min(pairs.size(), first + PAIR_CHUNK);
+            for (size_t p = first; p < last; p++) {
+                const Submission& sub1 = subs[pairs[p].first];
+                const Submission& sub2 = subs[pairs[p].second];
+                scores[p] = {pairs[p].first, pairs[p].second, scorePairBounded(sub1, sub2, options, options.minScore)};
+            }
+        });
+    }
+    pool.wait();
+    if (options.minScore != NO_SCORE) {
+        scores.erase(std::remove_if(scores.begin(), scores.end(), [&options](const ScoredPair& pair) {
+            return pair.score < options.minScore;
+        }), scores.end());
+    }
+    return scores;
+}
+
+// Orders pairs from most to least similar. Ties go to the lower indices, so the ranking does not
+// depend on which worker scored what
+static bool rankedBefore(const ScoredPair& a, const ScoredPair& b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.first != b.first) {
+        return a.first < b.first;
+    }
+    return a.second < b.second;
+}
+
+// Offers pair to a heap of the best k pairs seen so far. The worst of them sits at the front
+static void keepTopPair(std::vector<ScoredPair>& heap, size_t k, const ScoredPair& pair) {
+    if (heap.size() < k) {
+        heap.push_back(pair);
+        std::push_heap(heap.begin(), heap.end(), rankedBefore);
+    } else if (rankedBefore(pair, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), rankedBefore);
+        heap.back() = pair;
+        std::push_heap(heap.begin(), heap.end(), rankedBefore);
+    }
+}
+
+// Runs visit(worker, i, j) on pool for every pair i < j of n submissions and waits for all of them. There is one
+// task per band of PAIR_TILE rows rather than one per tile, so the queued tasks stay O(n) too
+template <typename Visit>
+static void visitAllPairs(size_t n, WorkStealingPool& pool, const Visit& visit) {
+    for (size_t row = 0; row < n; row += PAIR_TILE) {
+        pool.submit([&visit, n, row](unsigned worker) {
+            METRIC_PHASE(phase_compare);
+            size_t rowEnd = std::min(n, row + PAIR_TILE);
+            for (size_t i = row; i < rowEnd; i++) {
+                for (size_t j = i + 1; j < n; j++) {
+                    visit(worker, (uint32_t) i, (uint32_t) j);
+                }
+            }
+        });
+    }
+    pool.wait();
+}
+
+std::vector<ScoredPair> scoreTopPairs(const std::vector<Submission>& subs, size_t k, const BatchOptions& options) {
+    WorkStealingPool pool(options.threads);
+    std::vector<std::vector<ScoredPair>> heaps(pool.size());
+    // once a worker's heap is full, a pair has to reach the worst score in it to get in, so that is its cutoff
+    auto visit = [&subs, &options, &heaps, k](unsigned worker, uint32_t i, uint32_t j) {
+        std::vector<ScoredPair>& heap = heaps[worker];
+        int cutoff = heap.size() < k ? options.minScore : std::max(options.minScore, heap.front().score);
+        int score = scorePairBounded(subs[i], subs[j], options, cutoff);
+        if (score >= cutoff) {
+            keepTopPair(heap, k, {i, j, score});
+        }
+    };
+    if (options.prunes()) {
+        std::vector<std::pair<uint32_t, uint32_t>> pairs = findCandidatePairs(subs, options);
+        for (size_t first = 0; first < pairs.size(); first += PAIR_CHUNK) {
+            pool.submit([&pairs, &visit, first](unsigned worker) {
+                METRIC_PHASE(phase_compare);
+                size_t last = std::min(pairs.size(), first + PAIR_CHUNK);
+                for (size_t p = first; p < last; p++) {
+                    visit(worker, pairs[p].first, pairs[p].second);
+                }
+            });
+        }
+        pool.wait();
+    } else {
+        visitAllPairs(subs.size(), pool, visit);
+    }
+
+    std::vector<ScoredPair> top;
+    for (const std::vector<ScoredPair>& heap : heaps) {
+        for (const ScoredPair& pair : heap) {
+            keepTopPair(top, k, pair);
+        }
+    }
+    std::sort(top.begin(), top.end(), rankedBefore);
+    return top;
+}
+
+std::vector<ScoredPair> scorePairsAbove(const std::vector<Submission>& subs, const BatchOptions& options) {
+    WorkStealingPool pool(options.threads);
+    std::vector<std::vector<ScoredPair>> found(pool.size());
+    visitAllPairs(subs.size(), pool, [&subs, &options, &found](unsigned worker, uint32_t i, uint32_t j) {
+        int score = scorePairBounded(subs[i], subs[j], options, options.minScore);
+        if (score >= options.minScore) {
+            found[worker].push_back({i, j, score});
+        }
+    });
+
+    std::vector<ScoredPair> pairs;
+    for (const std::vector<ScoredPair>& part : found) {
+        pairs.insert(pairs.end(), part.begin(), part.end());
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const ScoredPair& a, const ScoredPair& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+    return pairs;
+}
+
+void writeScorePairs(FILE* out, const std::vector<Submission>& subs, const std::vector<ScoredPair>& scores) {
+    METRIC_PHASE(phase_write);
+    fprintf(out, "file1,file2,score\n");
+    for (const ScoredPair& pair : scores) {
+        fprintf(out, "%s,%s,%d\n", subs[pair.first].path.c_str(), subs[pair.second].path.c_str(), pair.score);
+    }
+}
+
+void writeRankedPairs(FILE* out, const std::vector<Submission>& subs, const std::vector<ScoredPair>& ranked) {
+    METRIC_PHASE(phase_write);
+    fprintf(out, "rank,file1,file2,score\n");
+    for (size_t r = 0; r < ranked.size(); r++) {
+        fprintf(out, "%zu,%s,%s,%d\n", r + 1, subs[ranked[r].first].path.c_str(), subs[ranked[r].second].path.c_str(),
+                ranked[r].score);
+    }
+}
+
+void writeScoreMatrixHeader(FILE* out, const std::vector<std::string>& paths) {
+    fprintf(out, "file");
+    for (const std::string& path : paths) {
+        fprintf(out, ",%s", path.c_str());
+    }
+    fprintf(out, "\n");
+}
+
+void writeScoreMatrixRow(FILE* out, const std::string& path, const int* scores, size_t n) {
+    fprintf(out, "%s", path.c_str());
+    for (size_t j = 0; j < n; j++) {
+        // pairs a pruned incremental run skipped are left empty
+        if (scores[j] == NO_SCORE) {
+            fprintf(out, ",");
+        } else {
+            fprintf(out, ",%d", scores[j]);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+void writeScoreMatrix(FILE* out, const std::vector<Submission>& subs, const std::vector<int>& scores) {
+    METRIC_PHASE(phase_write);
+    size_t n = subs.size();
+    std::vector<std::string> paths;
+    for (const Submission& sub : subs) {
+        paths.push_back(sub.path);
+    }
+    writeScoreMatrixHeader(out, paths);
+    for (size_t i = 0; i < n; i++) {
+        writeScoreMatrixRow(out, subs[i].path, &scores[i * n], n);
+    }
+}
+
+void freeSubmissions(std::vector<Submission>& subs) {
+    // each tree goes away with a single reset of its arena instead of a freeNode walk
+    for (Submission& sub : subs) {
+        if (sub.arena) {
+            sub.arena->reset();
+        } else if (sub.root != NULL) {
+            freeNode(sub.root);
+        }
+    }
+    subs.clear();
+}
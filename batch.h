@@ -0,0 +1,217 @@
+/*
+* h file for batch.cpp
+*
+* Batch mode parses a whole set of submissions exactly once, keeps their ASTs
+* in memory and scores every pair with compareTrees.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdio>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ast.h"
+#include "ast_arena.h"
+#include "corpus.h"
+#include "flat_ast.h"
+#include "tree_edit.h"
+
+// How a pair of submissions is scored
+typedef enum {
+		scorer_heuristic, // compareTrees / compareFlatTrees
+		scorer_ted        // 100 minus the tree edit distance, see tree_edit.h
+	} scorer_type;
+
+// Matrix entry of a pair that was never scored
+const int NO_SCORE = INT_MIN;
+
+// Settings shared by the loading and scoring stages of a batch run
+struct BatchOptions {
+    scorer_type scorer = scorer_heuristic;
+    TreeEditCosts editCosts; // costs of the ted scorer
+    unsigned threads = 0; // 0 = one per hardware thread
+    unsigned readers = 2;   // threads reading source files ahead of the parsers
+    size_t queueDepth = 0;  // files that may wait between two load stages; 0 = twice the parser threads
+    bool flat = false;    // score flattened trees with compareFlatTrees instead of the pointer ASTs
+    double minOverlap = 0; // > 0: only score pairs sharing at least this fraction of their fingerprints
+    unsigned lshLength = 0; // > 0: only score pairs whose MinHash signatures of this length collide in a band
+    unsigned lshBands = 0;
+    std::string cacheDir;   // non-empty: reuse and add parsed trees in this directory, see ast_cache.h
+    bool packing = false;   // keep the flat trees and fingerprints writeCorpus needs
+    size_t topPairs = 0;    // > 0: only keep this many of the most similar pairs, see scoreTopPairs
+    int minScore = NO_SCORE; // set: drop pairs scoring below this, which lets most comparisons stop early
+
+    // true if candidate pairs are generated instead of scoring the full matrix
+    bool prunes() const { return minOverlap > 0 || lshLength > 0; }
+};
+
+/**
+ * A parsed submission retained for the lifetime of the batch run. Its nodes live in arena.
+ * In flat mode only the flattened tree is kept and root is NULL. The edit distance scorer
+ * works on the flattened tree, so it is kept in that case too.
+ */
+struct Submission {
+    std::string path;
+    astNode* root = NULL;
+    std::unique_ptr<AstArena> arena;
+    FlatAst flat;
+    FlatAstView mapped;                 // the tree inside a mapped corpus, used instead of flat when set
+    uint64_t key = 0;                   // content hash of the source, only filled in when caching
+    std::vector<uint64_t> fingerprints; // winnowed k-grams, only filled in when pruning
+    std::vector<uint64_t> signature;    // MinHash of fingerprints, only filled in for LSH pruning
+    EditTree editTree;                  // the flat tree numbered for the ted scorer, only filled in for it
+
+    // the flat tree the flat passes score, wherever it is stored
+    FlatAstView flatTree() const { return mapped.nodeCount() > 0 ? mapped : FlatAstView(flat); }
+
+    // false if neither a pointer nor a flat tree could be obtained
+    bool loaded() const { return root != NULL || flatTree().nodeCount() > 0; }
+};
+
+// One entry of a pruned run: the score of subs[first] against subs[second]
+struct ScoredPair {
+    uint32_t first;
+    uint32_t second;
+    int score;
+};
+
+/**
+ * Parses a single MiniC file, running the semantic checks in the same pass. Parse and
+ * semantic errors are logged as warnings and written to the diagnostics channel, if it is open
+ * (see logging.h). With hash_canonical set the tree is returned in canonical form (see canonical.h).
+ * Safe to call from several threads at once.
+ * @param path is the file to parse.
+ * @param arena, if not NULL, receives every node of the tree; otherwise the nodes are heap allocated.
+ * returns: the root of the AST, or NULL if the file could not be opened or parsed.
+ * The caller owns the tree and releases it with arena->reset() or, without an arena, freeNode.
+ */
+astNode* parseSubmission(const char* path, AstArena* arena = NULL);
+
+/**
+ * Expands a batch source into a list of submission paths.
+ * If source is a directory, every regular *.c file inside it is used (sorted by name),
+ * otherwise source is read as a list file with one path per line.
+ * returns: false if source could not be read.
+ */
+bool collectSubmissionPaths(const char* source, std::vector<std::string>& paths);
+
+/**
+ * Parses every path exactly once into its own arena and flattens them in flat mode. When pruning, the
+ * fingerprints (and, for LSH, signatures) of every submission are computed as well. With a
+ * cache directory, files whose contents are already cached are not parsed at all. Files that fail to open or
+ * parse are reported on stderr and left out of the result, which keeps the input order.
+ * The files go through a pipeline: options.readers threads read them, options.threads threads parse
+ * them and half as many flatten and fingerprint them. The stages are joined by queues of options.queueDepth
+ * files, so no more than a few queues' worth of source text is held in memory at once.
+ */
+std::vector<Submission> loadSubmissions(const std::vector<std::string>& paths, const BatchOptions& options);
+
+/**
+ * Loads submissions straight from the cache in options.cacheDir by their content keys, without
+ * reading or parsing the source files. The result is parallel to paths; a submission whose
+ * entry is missing is left empty (see Submission::loaded).
+ */
+std::vector<Submission> loadCachedSubmissions(const std::vector<std::string>& paths, const std::vector<uint64_t>& keys,
+                                              const BatchOptions& options);
+
+/**
+ * Makes one flat-mode submission per tree of a mapped corpus. The trees are not copied; the
+ * submissions point into corpus, which must stay open while they are used. A tree that fails
+ * CorpusMapping::checkTree is reported and left out.
+ */
+std::vector<Submission> loadCorpus(const CorpusMapping& corpus, const BatchOptions& options);
+
+/**
+ * Checks one file against a packed corpus through the LSH band table stored in it. Only the file is
+ * parsed and only the corpus trees its signature collides with are copied out of the mapping, so the
+ * cost does not grow with the corpus. options.lshLength and lshBands must be the corpus' own.
+ * returns: the colliding trees that pass CorpusMapping::checkTree, in corpus order, followed by the
+ * query, or nothing if the query could not be parsed.
+ */
+std::vector<Submission> loadCorpusQuery(const CorpusMapping& corpus, const char* queryPath,
+                                        const BatchOptions& options);
+
+/**
+ * Scores all pairs of submissions on a work-stealing pool of options.threads threads.
+ * The result is a row-major N x N matrix where entry (i, j) is
+ * compareTrees(subs[i].root, subs[j].root), or compareFlatTrees in flat mode, or the
+ * edit distance score with the ted scorer.
+ */
+std::vector<int> scoreAllPairs(const std::vector<Submission>& subs, const BatchOptions& options);
+
+/**
+ * Candidate generation for large batches. With options.lshLength set, returns the pairs (i, j),
+ * i < j, whose signatures collide in at least one LSH band; otherwise indexes the fingerprints
+ * of every submission and returns the pairs that share at least options.minOverlap of them.
+ */
+std::vector<std::pair<uint32_t, uint32_t>> findCandidatePairs(const std::vector<Submission>& subs,
+                                                              const BatchOptions& options);
+
+/**
+ * The pairs of findCandidatePairs that involve a submission from firstNew on, for adding a few
+ * submissions to many: every (i, j), i < j, j >= firstNew. The later submissions are looked up
+ * in the index one by one, so no pair of two earlier submissions is ever considered.
+ */
+std::vector<std::pair<uint32_t, uint32_t>> findNewCandidatePairs(const std::vector<Submission>& subs, size_t firstNew,
+                                                                 const BatchOptions& options);
+
+/**
+ * Checks one submission against all the others through the LSH index.
+ * @param query is the index of the submission to look up; it is not indexed itself.
+ * returns: the pairs (i, query) whose signatures collide in at least one band.
+ */
+std::vector<std::pair<uint32_t, uint32_t>> findQueryCandidates(const std::vector<Submission>& subs, size_t query,
+                                                               const BatchOptions& options);
+
+// Scores only the given pairs, on a work-stealing pool of options.threads threads. With options.minScore
+// set, pairs scoring below it are left out
+std::vector<ScoredPair> scoreCandidatePairs(const std::vector<Submission>& subs,
+                                            const std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+                                            const BatchOptions& options);
+
+/**
+ * Scores every pair (i, j), i < j, or only the candidate pairs when options prune, and keeps the
+ * k highest scores at or above options.minScore. Each worker keeps its own bounded heap of k
+ * pairs and the heaps are merged at the end, so besides any candidate list memory is O(k threads)
+ * whatever the size of the batch. A pair that cannot beat the worst one in a full heap is given up
+ * on early.
+ * returns: at most k pairs, most similar first; equal scores are ordered by index.
+ */
+std::vector<ScoredPair> scoreTopPairs(const std::vector<Submission>& subs, size_t k, const BatchOptions& options);
+
+/**
+ * Scores every pair (i, j), i < j, and keeps those scoring at least options.minScore. Comparisons
+ * stop as soon as a pair cannot reach it, see compareTreesBounded.
+ * returns: the kept pairs ordered by index.
+ */
+std::vector<ScoredPair> scorePairsAbove(const std::vector<Submission>& subs, const BatchOptions& options);
+
+/**
+ * Writes the scored pairs as CSV, one "file1,file2,score" row per pair.
+ */
+void writeScorePairs(FILE* out, const std::vector<Submission>& subs, const std::vector<ScoredPair>& scores);
+
+// Writes ranked pairs as CSV, one "rank,file1,file2,score" row per pair, rank 1 first
+void writeRankedPairs(FILE* out, const std::vector<Submission>& subs, const std::vector<ScoredPair>& ranked);
+
+/**
+ * Writes the score matrix as CSV with a header row and a leading column of paths.
+ * NO_SCORE entries are written as empty fields.
+ */
+void writeScoreMatrix(FILE* out, const std::vector<Submission>& subs, const std::vector<int>& scores);
+
+// The header row of writeScoreMatrix, for writers that produce the matrix a row at a time
+void writeScoreMatrixHeader(FILE* out, const std::vector<std::string>& paths);
+
+// One row of writeScoreMatrix: path, then the n scores of its row
+void writeScoreMatrixRow(FILE* out, const std::string& path, const int* scores, size_t n);
+
+// Releases every AST held by subs
+void freeSubmissions(std::vector<Submission>& subs);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+*   MiniC Compiler - Arena Allocation Benchmark
+*
+*   Purpose: Builds the same synthetic ASTs through the create* functions twice, once on the plain calloc path torn
+*   down with freeNode and once inside an AstArena torn down with reset(), and reports how many heap allocations and
+*   how much time each path needs. Heap calls are counted by wrapping glibc's malloc family.
+*
+*   Usage: arena_bench [trees] [statements per tree]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <chrono>
+#include <vector>
+#include "ast.h"
+#include "ast_arena.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static size_t allocCount = 0;
+static size_t freeCount = 0;
+
+// malloc family wrappers; every heap allocation in the process, including operator new, goes through these
+extern "C" {
+void* malloc(size_t size) {
+    allocCount++;
+    return __libc_malloc(size);
+}
+void* calloc(size_t count, size_t size) {
+    allocCount++;
+    return __libc_calloc(count, size);
+}
+void* realloc(void* ptr, size_t size) {
+    allocCount++;
+    return __libc_realloc(ptr, size);
+}
+void free(void* ptr) {
+    if (ptr != NULL) {
+        freeCount++;
+    }
+    __libc_free(ptr);
+}
+}
+
+// Builds a function body of roughly the shape students write: declarations, then a loop of
+// assignments, conditionals and nested blocks
+static astNode* buildTree(int statements) {
+    static const char* names[] = {"a", "b", "count", "total", "i", "n", "result", "tmp"};
+    const int nameCount = sizeof(names) / sizeof(names[0]);
+
+    vector<astNode*>* body = new vector<astNode*>();
+    for (int i = 0; i < nameCount; i++) {
+        body->push_back(createDecl(names[i]));
+    }
+    for (int i = 0; i < statements; i++) {
+        const char* lhs = names[i % nameCount];
+        const char* rhs = names[(i * 3 + 1) % nameCount];
+        astNode* sum = createBExpr(createVar(rhs), createCnst(i), (op_type) (i % 4));
+        astNode* stmt = createAsgn(createVar(lhs), sum);
+        if (i % 5 == 0) {
+            vector<astNode*>* inner = new vector<astNode*>();
+            inner->push_back(stmt);
+            inner->push_back(createCall("print", createVar(lhs)));
+            astNode* cond = createRExpr(createVar(lhs), createCnst(i), lt);
+            stmt = createWhile(cond, createBlock(inner));
+        } else if (i % 7 == 0) {
+            astNode* cond = createRExpr(createVar(rhs), createUExpr(createCnst(i), uminus), gt);
+            stmt = createIf(cond, stmt, createRet(createVar(rhs)));
+        }
+        body->push_back(stmt);
+    }
+    body->push_back(createRet(createVar(names[0])));
+
+    astNode* func = createFunc("main", createVar("n"), createBlock(body));
+    return createProg(createExtern("print"), createExtern("read"), func);
+}
+
+struct PathResult {
+    size_t allocs;
+    size_t frees;
+    double buildMs;
+    double teardownMs;
+};
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static PathResult runHeap(int trees, int statements) {
+    std::vector<astNode*> roots;
+    roots.reserve(trees);
+    size_t allocs0 = allocCount, frees0 = freeCount;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < trees; t++) {
+        roots.push_back(buildTree(statements));
+    }
+    double buildMs = msSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (astNode* root : roots) {
+        freeNode(root);
+    }
+    double teardownMs = msSince(start);
+
+    return {allocCount - allocs0, freeCount - frees0, buildMs, teardownMs};
+}
+
+static PathResult runArena(int trees, int statements) {
+    std::vector<AstArena*> arenas;
+    arenas.reserve(trees);
+    for (int t = 0; t < trees; t++) {
+        arenas.push_back(new AstArena());
+    }
+    size_t allocs0 = allocCount, frees0 = freeCount;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < trees; t++) {
+        AstArenaScope scope(*arenas[t]);
+        buildTree(statements);
+    }
+    double buildMs = msSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (AstArena* arena : arenas) {
+        arena->reset();
+    }
+    double teardownMs = msSince(start);
+
+    PathResult result = {allocCount - allocs0, freeCount - frees0, buildMs, teardownMs};
+    for (AstArena* arena : arenas) {
+        delete arena;
+    }
+    return result;
+}
+
+static void report(const char* name, const PathResult& r, int trees) {
+    printf("%-6s allocs %10zu (%8.1f/tree)  frees %10zu  build %8.2f ms  teardown %8.2f ms\n",
+           name, r.allocs, (double) r.allocs / trees, r.frees, r.buildMs, r.teardownMs);
+}
+
+int main(int argc, char* argv[]) {
+    int trees = argc > 1 ? atoi(argv[1]) : 2000;
+    int statements = argc > 2 ? atoi(argv[2]) : 200;
+
+    printf("%d trees, %d statements each\n", trees, statements);
+    PathResult heap = runHeap(trees, statements);
+    PathResult arena = runArena(trees, statements);
+    report("heap", heap, trees);
+    report("arena", arena, trees);
+    return 0;
+}
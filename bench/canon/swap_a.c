@@ -0,0 +1,13 @@
+extern void print(int);
+extern int read();
+int func(int n){
+	int x;
+	int a;
+	int b;
+	a = read();
+	b = read();
+	x = a + b;
+	if (x == n) { print(x); }
+	while (x < n) { x = x * 2; }
+	return x;
+}
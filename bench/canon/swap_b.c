@@ -0,0 +1,13 @@
+extern void print(int);
+extern int read();
+int func(int n){
+	int y;
+	int a;
+	int b;
+	a = read();
+	b = read();
+	y = b + a;
+	if (n == y) { print(y); }
+	while (y < n) { y = 2 * y; }
+	return y;
+}
@@ -0,0 +1,302 @@
+/*
+*   MiniC Compiler - Synthetic Corpus Generator
+*
+*   Purpose: Writes a corpus of valid MiniC programs for the benchmarks. Programs come in families: the first member
+*   of a family is generated from the family's seed, the others are copies of it in which statements were replaced,
+*   deleted or inserted and variables renamed, each at the mutation rate, the way students copying one another
+*   disguise their work. Every program follows the grammar in yacc.y and declares every variable it uses.
+*
+*   Usage: gen_minic [-f families] [-v variants] [-s statements] [-d depth] [-m rate] [-r seed] outdir
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* const NAMES[] = {"a", "b", "c", "i", "j", "n", "x", "y", "count", "total", "sum", "tmp",
+                                    "result", "val", "idx", "acc"};
+static const int NAME_COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+static const char* const REL_OPS[] = {"==", ">", "<", ">=", "<="};
+static const char* const ARITH_OPS[] = {"+", "-", "*", "/"};
+
+struct GenOptions {
+    int families = 20;
+    int variants = 10;     // programs per family, the original included
+    int statements = 60;   // statements in the function body
+    int depth = 4;         // deepest nesting of while, if and block statements
+    double mutation = 0.1; // chance of each mutation per statement and per name
+    uint64_t seed = 1;
+};
+
+// Writes one program. Structure comes from base, which is seeded the same for every member of a family; the
+// mutations draw from mut, so a variant only departs from the original where a mutation fires
+class ProgramWriter {
+public:
+    ProgramWriter(const GenOptions& options, uint64_t familySeed, uint64_t variantSeed, bool mutate)
+        : options(options), base(familySeed), mut(variantSeed), mutate(mutate) {
+        for (int i = 0; i < NAME_COUNT; i++) {
+            names.push_back(NAMES[i]);
+            if (mutate && chance(mut, options.mutation)) {
+                names.back() += "_" + std::to_string(i);
+            }
+        }
+    }
+
+    std::string program() {
+        out = "extern void print(int);\nextern int read();\n\n";
+        bool param = pick(base, 4) != 0;
+        scopes.assign(1, std::vector<int>());
+        out += "int func(";
+        if (param) {
+            int name = pick(base, NAME_COUNT);
+            scopes[0].push_back(name);
+            out += "int " + names[name];
+        }
+        out += ") ";
+        // the parameter shares its scope with the declarations of the body
+        block(0, options.statements, false, std::string());
+        out += "\n";
+        return out;
+    }
+
+private:
+    const GenOptions& options;
+    std::mt19937_64 base, mut;
+    bool mutate;
+    std::vector<std::string> names;
+    std::vector<std::vector<int>> scopes; // names declared in each open scope, outermost first
+    std::string out;
+
+    static bool chance(std::mt19937_64& rng, double p) {
+        return std::uniform_real_distribution<double>(0, 1)(rng) < p;
+    }
+
+    static int pick(std::mt19937_64& rng, int n) {
+        return (int) (rng() % (uint64_t) n);
+    }
+
+    // a variable visible at this point
+    const std::string& visible(std::mt19937_64& rng) {
+        std::vector<int> all;
+        for (const std::vector<int>& scope : scopes) {
+            all.insert(all.end(), scope.begin(), scope.end());
+        }
+        return names[all[pick(rng, all.size())]];
+    }
+
+    std::string term(std::mt19937_64& rng) {
+        switch (pick(rng, 5)) {
+            case 0:
+            case 1:
+                return visible(rng);
+            case 2:
+                return "-" + visible(rng);
+            default:
+                return std::to_string(pick(rng, 100));
+        }
+    }
+
+    std::string expr(std::mt19937_64& rng) {
+        int kind = pick(rng, 8);
+        if (kind == 0) {
+            return "read()";
+        }
+        if (kind < 3) {
+            return term(rng);
+        }
+        return term(rng) + " " + ARITH_OPS[pick(rng, 4)] + " " + term(rng);
+    }
+
+    std::string cond(std::mt19937_64& rng) {
+        return expr(rng) + " " + REL_OPS[pick(rng, 5)] + " " + expr(rng);
+    }
+
+    // writes "{ declarations statements }" in a new scope; with scope false the declarations go into the innermost
+    // scope instead, as those of a function body do
+    void block(int level, int statements, bool scope, const std::string& indent) {
+        if (scope) {
+            scopes.push_back(std::vector<int>());
+        }
+        out += "{\n";
+        std::string inner = indent + "    ";
+        int decls = pick(base, 3);
+        for (int d = 0; d < decls; d++) {
+            int name = pick(base, NAME_COUNT);
+            bool taken = false;
+            for (int declared : scopes.back()) {
+                taken = taken || declared == name;
+            }
+            if (!taken) {
+                scopes.back().push_back(name);
+                out += inner + "int " + names[name] + ";\n";
+            }
+        }
+        // at least one variable must be visible for the statements to use
+        if (scopes.size() == 1 && scopes[0].empty()) {
+            scopes.back().push_back(0);
+            out += inner + "int " + names[0] + ";\n";
+        }
+
+        size_t start = out.size();
+        for (int s = 0; s < statements; s++) {
+            // the original statement is always generated, so base stays in step with the other variants
+            std::string original = statementText(base, level, inner);
+            if (!mutate || !chance(mut, options.mutation)) {
+                out += original;
+                continue;
+            }
+            switch (pick(mut, 3)) {
+                case 0: // replaced
+                    out += statementText(mut, level, inner);
+                    break;
+                case 1: // deleted
+                    break;
+                default: // another statement inserted before it
+                    out += statementText(mut, level, inner);
+                    out += original;
+                    break;
+            }
+        }
+        if (out.size() == start) {
+            // a block needs at least one statement
+            out += inner + visible(base) + " = " + expr(base) + ";\n";
+        }
+        out += indent + "}";
+        if (scope) {
+            scopes.pop_back();
+        }
+    }
+
+    // one statement, as text, drawn from rng
+    std::string statementText(std::mt19937_64& rng, int level, const std::string& indent) {
+        std::string saved;
+        saved.swap(out);
+        statement(rng, level, indent);
+        saved.swap(out);
+        return saved;
+    }
+
+    void statement(std::mt19937_64& rng, int level, const std::string& indent) {
+        // compound statements get rarer with depth, which keeps the size of a program close to linear in statements
+        int kind = pick(rng, 6);
+        if (level < options.depth && pick(rng, 5 * (level + 2)) < 4) {
+            kind = 6 + pick(rng, 4);
+        }
+        switch (kind) {
+            case 0:
+            case 1:
+            case 2:
+                out += indent + visible(rng) + " = " + expr(rng) + ";\n";
+                return;
+            case 3:
+            case 4:
+                out += indent + "print(" + expr(rng) + ");\n";
+                return;
+            case 5:
+                out += indent + "return " + expr(rng) + ";\n";
+                return;
+            case 6:
+                out += indent + "while (" + cond(rng) + ") ";
+                nested(rng, level, indent);
+                out += "\n";
+                return;
+            case 7:
+            case 8:
+                out += indent + "if (" + cond(rng) + ") ";
+                nested(rng, level, indent);
+                if (pick(rng, 2) == 0) {
+                    out += " else ";
+                    nested(rng, level, indent);
+                }
+                out += "\n";
+                return;
+            default:
+                out += indent;
+                nested(rng, level, indent);
+                out += "\n";
+                return;
+        }
+    }
+
+    // a nested block of a few statements; its structure comes from rng too
+    void nested(std::mt19937_64& rng, int level, const std::string& indent) {
+        std::mt19937_64 saved = base;
+        base = rng;
+        block(level + 1, 1 + pick(base, 4), true, indent);
+        rng = base;
+        base = saved;
+    }
+};
+
+static uint64_t mix(uint64_t a, uint64_t b) {
+    uint64_t h = a * 0x9e3779b97f4a7c15ULL ^ (b + 0x632be59bd9b4e019ULL);
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 29);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-f families] [-v variants] [-s statements] [-d depth] [-m rate] [-r seed] outdir\n",
+            prog);
+}
+
+int main(int argc, char* argv[]) {
+    GenOptions options;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:v:s:d:m:r:")) != -1) {
+        switch (opt) {
+            case 'f':
+                options.families = atoi(optarg);
+                break;
+            case 'v':
+                options.variants = atoi(optarg);
+                break;
+            case 's':
+                options.statements = atoi(optarg);
+                break;
+            case 'd':
+                options.depth = atoi(optarg);
+                break;
+            case 'm':
+                options.mutation = atof(optarg);
+                break;
+            case 'r':
+                options.seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind != 1 || options.families < 1 || options.variants < 1 || options.statements < 1 ||
+        options.depth < 0 || options.mutation < 0 || options.mutation > 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* outDir = argv[optind];
+    if (mkdir(outDir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s\n", outDir);
+        return 1;
+    }
+
+    for (int f = 0; f < options.families; f++) {
+        uint64_t familySeed = mix(options.seed, f);
+        for (int v = 0; v < options.variants; v++) {
+            ProgramWriter writer(options, familySeed, mix(familySeed, v + 1), v > 0);
+            std::string text = writer.program();
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/f%03d_v%02d.c", outDir, f, v);
+            FILE* file = fopen(path, "w");
+            if (file == NULL || fwrite(text.data(), 1, text.size(), file) != text.size() || fclose(file) != 0) {
+                fprintf(stderr, "Cannot write %s\n", path);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
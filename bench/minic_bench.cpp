@@ -0,0 +1,369 @@
+/*
+*   MiniC Compiler - Pipeline Benchmarks
+*
+*   Purpose: Times every stage a batch run goes through on a corpus of MiniC files (see gen_minic.cpp): lexing and
+*   parsing with the fused semantic checks, each with the flex and the mapped scanner, a separate visitNode walk, compareTrees on single pairs, and the scoring
+*   of the whole matrix on the pointer and the flat trees. Each stage reports ns per AST node and, for scoring,
+*   pairs per second. The results are written as JSON and compared with a stored baseline, so a change that slows
+*   a stage down shows up as a regression.
+*
+*   Usage: minic_bench [-o results.json] [-b baseline.json] [-r repeats] [-p files] [-t percent] corpus
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "batch.h"
+#include "inclass.h"
+#include "parser.h"
+#include "scanner.h"
+#include "semantic_analysis.h"
+#include "yacc.tab.h"
+
+extern int yylex(YYSTYPE *yylval_param, yyscan_t scanner);
+extern int yylex_init(yyscan_t *scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern void yyset_in(FILE *in, yyscan_t scanner);
+
+struct BenchResult {
+    std::string name;
+    double seconds;     // fastest of the repeats
+    double nsPerNode;   // < 0 if not measured
+    double pairsPerSec; // < 0 if not measured
+};
+
+struct BenchOptions {
+    const char* outPath = "bench/results.json";
+    const char* baselinePath = NULL;
+    int repeats = 3;
+    size_t compareFiles = 100; // the compareTrees stage scores all pairs of this many files on one thread
+    double threshold = 15;     // percent slower than the baseline that counts as a regression
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// runs stage repeats times and returns the fastest time
+template <typename Stage>
+static double fastest(int repeats, Stage stage) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        double seconds = secondsSince(start);
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+static bool readFile(const std::string& path, std::string& text) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char buffer[65536];
+    size_t len;
+    text.clear();
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, len);
+    }
+    fclose(file);
+    return true;
+}
+
+// scans every source from memory with the flex scanner and returns the number of tokens
+static size_t lexAll(std::vector<std::string>& sources) {
+    size_t tokens = 0;
+    for (std::string& text : sources) {
+        FILE* in = fmemopen(&text[0], text.size(), "r");
+        yyscan_t scanner;
+        yylex_init(&scanner);
+        yyset_in(in, scanner);
+        YYSTYPE value;
+        while (yylex(&value, scanner) != 0) {
+            tokens++;
+        }
+        yylex_destroy(scanner);
+        fclose(in);
+    }
+    return tokens;
+}
+
+// scans every file through a mapping of it, as parseFile does by default, and returns the number of tokens
+static size_t lexMapped(const std::vector<std::string>& paths) {
+    size_t tokens = 0;
+    for (const std::string& path : paths) {
+        MappedSource source;
+        if (!source.open(path.c_str())) {
+            continue;
+        }
+        MiniCScanner scanner(source.data(), source.size());
+        MappedToken token;
+        while (scanner.next(token) != 0) {
+            if (token.kind == ID) {
+                scanner.symbol(token);
+            }
+            tokens++;
+        }
+    }
+    return tokens;
+}
+
+static void parseAll(const std::vector<std::string>& paths) {
+    for (const std::string& path : paths) {
+        ParseDiagnostics diag;
+        astNode* root = parseFile(path.c_str(), diag);
+        if (root != NULL) {
+            freeNode(root);
+        }
+    }
+}
+
+static void visitAll(const std::vector<astNode*>& roots) {
+    for (astNode* root : roots) {
+        ScopedSymbolTable symbols;
+        visitNode(root, symbols);
+    }
+}
+
+// scores every pair of roots on this thread; returns a checksum so the work cannot be optimized away
+static long compareAll(const std::vector<astNode*>& roots) {
+    long sum = 0;
+    for (size_t i = 0; i < roots.size(); i++) {
+        for (size_t j = i + 1; j < roots.size(); j++) {
+            sum += compareTrees(roots[i], roots[j]);
+        }
+    }
+    return sum;
+}
+
+static void writeResults(FILE* out, const char* corpus, size_t files, size_t nodes, size_t bytes,
+                         const std::vector<BenchResult>& results) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"corpus\": {\"path\": \"%s\", \"files\": %zu, \"nodes\": %zu, \"bytes\": %zu},\n", corpus, files,
+            nodes, bytes);
+    fprintf(out, "  \"benchmarks\": {\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        fprintf(out, "    \"%s\": {\"seconds\": %.6f", result.name.c_str(), result.seconds);
+        if (result.nsPerNode >= 0) {
+            fprintf(out, ", \"ns_per_node\": %.3f", result.nsPerNode);
+        }
+        if (result.pairsPerSec >= 0) {
+            fprintf(out, ", \"pairs_per_sec\": %.1f", result.pairsPerSec);
+        }
+        fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  }\n}\n");
+}
+
+// Reads back a file written by writeResults: every benchmark sits on a line of its own
+static std::vector<BenchResult> readResults(const char* path) {
+    std::vector<BenchResult> results;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return results;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char name[256];
+        if (sscanf(line, " \"%255[^\"]\": {\"seconds\": ", name) != 1 || strstr(line, "\"seconds\"") == NULL) {
+            continue;
+        }
+        BenchResult result = {name, 0, -1, -1};
+        const char* field;
+        if ((field = strstr(line, "\"seconds\": ")) != NULL) {
+            result.seconds = atof(field + strlen("\"seconds\": "));
+        }
+        if ((field = strstr(line, "\"ns_per_node\": ")) != NULL) {
+            result.nsPerNode = atof(field + strlen("\"ns_per_node\": "));
+        }
+        if ((field = strstr(line, "\"pairs_per_sec\": ")) != NULL) {
+            result.pairsPerSec = atof(field + strlen("\"pairs_per_sec\": "));
+        }
+        results.push_back(result);
+    }
+    fclose(file);
+    return results;
+}
+
+// prints one metric against its baseline value; slowdown is the fraction by which the current run is slower
+static bool compareMetric(const char* bench, const char* metric, double current, double baseline, double slowdown,
+                          double threshold) {
+    bool regressed = slowdown * 100 > threshold;
+    printf("  %-16s %-14s %14.2f %14.2f %+8.1f%%%s\n", bench, metric, current, baseline, slowdown * 100,
+           regressed ? "  REGRESSION" : "");
+    return regressed;
+}
+
+// returns the number of metrics more than threshold percent slower than the baseline
+static int compareWithBaseline(const std::vector<BenchResult>& results, const std::vector<BenchResult>& baseline,
+                               double threshold) {
+    printf("  %-16s %-14s %14s %14s %9s\n", "benchmark", "metric", "current", "baseline", "slower");
+    int regressions = 0;
+    for (const BenchResult& result : results) {
+        for (const BenchResult& old : baseline) {
+            if (old.name != result.name) {
+                continue;
+            }
+            if (result.nsPerNode > 0 && old.nsPerNode > 0) {
+                regressions += compareMetric(result.name.c_str(), "ns/node", result.nsPerNode, old.nsPerNode,
+                                             result.nsPerNode / old.nsPerNode - 1, threshold);
+            }
+            if (result.pairsPerSec > 0 && old.pairsPerSec > 0) {
+                regressions += compareMetric(result.name.c_str(), "pairs/sec", result.pairsPerSec, old.pairsPerSec,
+                                             old.pairsPerSec / result.pairsPerSec - 1, threshold);
+            }
+        }
+    }
+    return regressions;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-o results.json] [-b baseline.json] [-r repeats] [-p files] [-t percent] corpus\n",
+            prog);
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:b:r:p:t:")) != -1) {
+        switch (opt) {
+            case 'o':
+                options.outPath = optarg;
+                break;
+            case 'b':
+                options.baselinePath = optarg;
+                break;
+            case 'r':
+                options.repeats = atoi(optarg);
+                break;
+            case 'p':
+                options.compareFiles = (size_t) atol(optarg);
+                break;
+            case 't':
+                options.threshold = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind != 1 || options.repeats < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* corpus = argv[optind];
+
+    std::vector<std::string> paths;
+    if (!collectSubmissionPaths(corpus, paths) || paths.empty()) {
+        fprintf(stderr, "No MiniC files in %s\n", corpus);
+        return 1;
+    }
+    std::vector<std::string> sources(paths.size());
+    size_t bytes = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!readFile(paths[i], sources[i])) {
+            fprintf(stderr, "Cannot read %s\n", paths[i].c_str());
+            return 1;
+        }
+        bytes += sources[i].size();
+    }
+
+    // the trees the later stages work on, parsed once up front
+    std::vector<astNode*> roots;
+    size_t nodes = 0;
+    for (const std::string& path : paths) {
+        astNode* root = parseSubmission(path.c_str());
+        if (root == NULL) {
+            return 1;
+        }
+        roots.push_back(root);
+        nodes += root->size;
+    }
+    printf("%zu files, %zu nodes, %zu bytes\n", paths.size(), nodes, bytes);
+
+    std::vector<BenchResult> results;
+    size_t tokens = 0;
+    double seconds = fastest(options.repeats, [&]() { tokens = lexAll(sources); });
+    results.push_back({"lex", seconds, seconds * 1e9 / nodes, -1});
+
+    seconds = fastest(options.repeats, [&]() { lexMapped(paths); });
+    results.push_back({"lex_mapped", seconds, seconds * 1e9 / nodes, -1});
+
+    setParserScanner(scanner_flex);
+    seconds = fastest(options.repeats, [&]() { parseAll(paths); });
+    results.push_back({"parse", seconds, seconds * 1e9 / nodes, -1});
+
+    setParserScanner(scanner_mapped);
+    seconds = fastest(options.repeats, [&]() { parseAll(paths); });
+    results.push_back({"parse_mapped", seconds, seconds * 1e9 / nodes, -1});
+
+    seconds = fastest(options.repeats, [&]() { visitAll(roots); });
+    results.push_back({"visit", seconds, seconds * 1e9 / nodes, -1});
+
+    std::vector<astNode*> sample(roots.begin(), roots.begin() + std::min(options.compareFiles, roots.size()));
+    size_t pairNodes = 0, samplePairs = sample.size() * (sample.size() - 1) / 2;
+    for (size_t i = 0; i < sample.size(); i++) {
+        pairNodes += sample[i]->size * (sample.size() - 1);
+    }
+    long checksum = 0;
+    seconds = fastest(options.repeats, [&]() { checksum = compareAll(sample); });
+    results.push_back({"compare", seconds, pairNodes > 0 ? seconds * 1e9 / pairNodes : -1,
+                       samplePairs > 0 ? samplePairs / seconds : -1});
+
+    // the whole matrix, on the pool, as a batch run scores it
+    size_t pairs = paths.size() * (paths.size() - 1) / 2;
+    for (int flat = 0; flat < 2; flat++) {
+        BatchOptions batch;
+        batch.flat = flat != 0;
+        std::vector<Submission> subs = loadSubmissions(paths, batch);
+        seconds = fastest(options.repeats, [&]() { checksum += scoreAllPairs(subs, batch)[0]; });
+        results.push_back({flat ? "all_pairs_flat" : "all_pairs", seconds, -1, pairs > 0 ? pairs / seconds : -1});
+        freeSubmissions(subs);
+    }
+    for (astNode* root : roots) {
+        freeNode(root);
+    }
+
+    for (const BenchResult& result : results) {
+        printf("  %-16s %10.3f ms", result.name.c_str(), result.seconds * 1e3);
+        if (result.nsPerNode >= 0) {
+            printf("  %10.2f ns/node", result.nsPerNode);
+        }
+        if (result.pairsPerSec >= 0) {
+            printf("  %12.0f pairs/sec", result.pairsPerSec);
+        }
+        printf("\n");
+    }
+    printf("(%zu tokens, checksum %ld)\n", tokens, checksum);
+
+    FILE* out = fopen(options.outPath, "w");
+    if (out == NULL) {
+        fprintf(stderr, "File open error: %s\n", options.outPath);
+        return 1;
+    }
+    writeResults(out, corpus, paths.size(), nodes, bytes, results);
+    fclose(out);
+
+    if (options.baselinePath != NULL) {
+        std::vector<BenchResult> baseline = readResults(options.baselinePath);
+        if (baseline.empty()) {
+            printf("No baseline in %s\n", options.baselinePath);
+        } else {
+            int regressions = compareWithBaseline(results, baseline, options.threshold);
+            printf("%d regression%s over %.0f%% against %s\n", regressions, regressions == 1 ? "" : "s",
+                   options.threshold, options.baselinePath);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+* A blocking queue of bounded capacity for connecting the stages of a pipeline
+*
+* Any number of threads may push and pop. push blocks while the queue is full,
+* which is what holds a fast stage back to the pace of a slow one and caps how
+* much work, and memory, is in flight between them. The queue is told how many
+* producers feed it; once the last of them has called producerDone, pop drains
+* what is left and then returns false, which is how the consumers learn that
+* the stage before them has finished.
+*/
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity, unsigned producers)
+        : capacity(capacity > 0 ? capacity : 1), producers(producers) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Appends item, waiting while the queue is full
+    void push(T item) {
+        std::unique_lock<std::mutex> guard(lock);
+        notFull.wait(guard, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        guard.unlock();
+        notEmpty.notify_one();
+    }
+
+    /**
+     * Takes the oldest item, waiting while the queue is empty.
+     * returns: false once every producer is done and the queue has been drained.
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> guard(lock);
+        notEmpty.wait(guard, [this] { return !items.empty() || producers == 0; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        guard.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Called by each producer once it will push nothing more
+    void producerDone() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            producers--;
+        }
+        notEmpty.notify_all();
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    size_t capacity;
+    unsigned producers;
+};
+
+#endif
@@ -0,0 +1,252 @@
+/*
+*   MiniC Compiler - Canonical Form
+*
+*   Purpose: Renaming variables or writing b + a for a + b changes the structural hash of every enclosing subtree, so
+*   the hash shortcut in compareTrees and the fingerprints never match such copies and the full comparison has to
+*   find them node by node. This file rewrites a tree into a form those edits do not change: variables named by
+*   first use within their scopes and commutative operands in hash order.
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "canonical.h"
+#include "scoped_symbol_table.h"
+#include "symbol.h"
+
+// index of a variable that has not been used yet
+static const uint32_t UNNAMED = UINT32_MAX;
+
+// A declared variable: the scope it belongs to and its place in the order of first use there
+struct CanonicalVar {
+    uint32_t depth;
+    uint32_t index;
+};
+
+// One step of a walk: visit a node, finish it once its children are done, or close the scope of a block
+struct CanonicalStep {
+    enum { visit, finish, closeScope } kind;
+    astNode* node;
+    astNode* param; // the function parameter sharing a closeScope's scope, or NULL
+};
+
+class Canonicalizer {
+public:
+    // the outermost scope takes whatever is used outside any function, so every variable has a scope
+    Canonicalizer() { pushScope(); }
+
+    void walk(astNode* root);
+
+private:
+    void visit(astNode* node);
+    void openScope(astNode* block, astNode* param);
+    void closeScope(astNode* block, astNode* param);
+    void pushScope();
+    void popScope();
+    void declare(symbol_id name);
+    CanonicalVar& use(symbol_id name);
+    symbol_id canonicalName(const CanonicalVar& var);
+
+    ScopedSymbolTable symbols;    // binds each name to its entry in vars
+    std::vector<CanonicalVar> vars;
+    std::vector<uint32_t> used;   // variables used so far in each open scope
+    std::vector<std::vector<symbol_id>> names; // names[d][i] is the interned "$d_i"
+};
+
+// pending steps of the walks on this thread, the next one last
+static thread_local std::vector<CanonicalStep> steps;
+
+void Canonicalizer::pushScope() {
+    symbols.pushScope();
+    used.push_back(0);
+}
+
+void Canonicalizer::popScope() {
+    symbols.popScope();
+    used.pop_back();
+}
+
+void Canonicalizer::declare(symbol_id name) {
+    if (symbols.declare(name, (uint32_t) vars.size())) {
+        vars.push_back({(uint32_t) symbols.depth(), UNNAMED});
+    }
+}
+
+// the variable name refers to here, numbered within its scope on its first use
+CanonicalVar& Canonicalizer::use(symbol_id name) {
+    uint32_t* entry = symbols.lookup(name);
+    if (entry == NULL) {
+        // used without a declaration: the semantic checks reported it, it is named as if declared here
+        declare(name);
+        entry = symbols.lookup(name);
+    }
+    CanonicalVar& var = vars[*entry];
+    if (var.index == UNNAMED) {
+        var.index = used[var.depth - 1]++;
+    }
+    return var;
+}
+
+symbol_id Canonicalizer::canonicalName(const CanonicalVar& var) {
+    if (names.size() <= var.depth) {
+        names.resize(var.depth + 1);
+    }
+    std::vector<symbol_id>& level = names[var.depth];
+    while (level.size() <= var.index) {
+        char spelling[32];
+        snprintf(spelling, sizeof(spelling), "$%u_%u", (unsigned) var.depth, (unsigned) level.size());
+        level.push_back(internSymbol(spelling));
+    }
+    return level[var.index];
+}
+
+// number of declarations at the head of a block's statement list
+static size_t leadingDecls(const vector<astNode*>* list) {
+    size_t decls = 0;
+    while (list != NULL && decls < list->size() && list->at(decls) != NULL && list->at(decls)->type == ast_stmt &&
+           list->at(decls)->stmt.type == ast_decl) {
+        decls++;
+    }
+    return decls;
+}
+
+// Opens the scope of a block, which a function's parameter shares with the body, and queues its statements.
+// The declarations at its head are only declared here; they are named when the scope closes, once every use in
+// it has been seen
+void Canonicalizer::openScope(astNode* block, astNode* param) {
+    pushScope();
+    if (param != NULL) {
+        declare(param->var.name);
+    }
+    vector<astNode*>* list = block->stmt.block.stmt_list;
+    size_t decls = leadingDecls(list);
+    for (size_t i = 0; i < decls; i++) {
+        declare(list->at(i)->stmt.decl.name);
+    }
+    steps.push_back({CanonicalStep::closeScope, block, param});
+    if (list != NULL) {
+        for (size_t i = list->size(); i > decls; i--) {
+            if (list->at(i - 1) != NULL) {
+                steps.push_back({CanonicalStep::visit, list->at(i - 1), NULL});
+            }
+        }
+    }
+}
+
+void Canonicalizer::closeScope(astNode* block, astNode* param) {
+    vector<astNode*>* list = block->stmt.block.stmt_list;
+    size_t decls = leadingDecls(list);
+
+    // what was never used is numbered after everything that was, in declaration order
+    if (param != NULL) {
+        param->var.name = canonicalName(use(param->var.name));
+        rehashNode(param);
+    }
+    if (decls > 0) {
+        std::vector<std::pair<uint32_t, astNode*>> named;
+        for (size_t i = 0; i < decls; i++) {
+            astNode* decl = list->at(i);
+            const CanonicalVar& var = use(decl->stmt.decl.name);
+            decl->stmt.decl.name = canonicalName(var);
+            rehashNode(decl);
+            named.push_back({var.index, decl});
+        }
+        // a redeclared name shares its index with the first declaration, so the sort has to be stable
+        std::stable_sort(named.begin(), named.end(),
+                         [](const std::pair<uint32_t, astNode*>& a, const std::pair<uint32_t, astNode*>& b) {
+                             return a.first < b.first;
+                         });
+        for (size_t i = 0; i < decls; i++) {
+            (*list)[i] = named[i].second;
+        }
+    }
+    popScope();
+}
+
+// true if swapping the operands of node cannot change what it computes
+static bool isCommutative(const astNode* node) {
+    if (node->type == ast_bexpr) {
+        return node->bexpr.op == add || node->bexpr.op == mul;
+    }
+    return node->type == ast_rexpr && (node->rexpr.op == eq || node->rexpr.op == neq);
+}
+
+// Renames a variable or declaration on the spot; any other node is finished after its children, and blocks and
+// function bodies get a scope of their own
+void Canonicalizer::visit(astNode* node) {
+    if (node->type == ast_var) {
+        node->var.name = canonicalName(use(node->var.name));
+        rehashNode(node);
+        return;
+    }
+    if (node->type == ast_stmt && node->stmt.type == ast_decl) {
+        // declarations after the head of a block are named on the spot
+        declare(node->stmt.decl.name);
+        node->stmt.decl.name = canonicalName(use(node->stmt.decl.name));
+        rehashNode(node);
+        return;
+    }
+    if (node->type == ast_stmt && node->stmt.type == ast_block) {
+        // closing the scope finishes the block
+        openScope(node, NULL);
+        return;
+    }
+    steps.push_back({CanonicalStep::finish, node, NULL});
+    if (node->type == ast_func) {
+        // the parameter is named with the body's declarations, not walked as a use
+        if (node->func.body != NULL) {
+            openScope(node->func.body, node->func.param);
+        }
+        return;
+    }
+    // children are pushed in source order and reversed, so they are visited in source order
+    size_t first = steps.size();
+    forEachChild(node, [](astNode* child) {
+        if (child != NULL) {
+            steps.push_back({CanonicalStep::visit, child, NULL});
+        }
+    });
+    std::reverse(steps.begin() + first, steps.end());
+}
+
+// Renames the variables under root and reorders its commutative operands, children first, then recomputes the
+// hashes. Operands are visited in source order before they are sorted, so in both "a + b" and "b + a" the variable
+// written first is numbered first. Externs keep their names. Walks with an explicit stack, as nesting is unbounded
+void Canonicalizer::walk(astNode* root) {
+    if (root == NULL) {
+        return;
+    }
+    size_t base = steps.size();
+    steps.push_back({CanonicalStep::visit, root, NULL});
+    while (steps.size() > base) {
+        CanonicalStep step = steps.back();
+        steps.pop_back();
+        astNode* node = step.node;
+        switch (step.kind) {
+            case CanonicalStep::visit:
+                visit(node);
+                break;
+            case CanonicalStep::closeScope:
+                closeScope(node, step.param);
+                rehashNode(node);
+                break;
+            case CanonicalStep::finish:
+                if (isCommutative(node)) {
+                    // the two expression kinds keep their operands in the same place
+                    astNode** lhs = node->type == ast_rexpr ? &node->rexpr.lhs : &node->bexpr.lhs;
+                    astNode** rhs = node->type == ast_rexpr ? &node->rexpr.rhs : &node->bexpr.rhs;
+                    if (*lhs != NULL && *rhs != NULL && (*rhs)->hash < (*lhs)->hash) {
+                        std::swap(*lhs, *rhs);
+                    }
+                }
+                rehashNode(node);
+                break;
+        }
+    }
+}
+
+void canonicalizeTree(astNode* root) {
+    Canonicalizer canonicalizer;
+    canonicalizer.walk(root);
+}
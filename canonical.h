@@ -0,0 +1,27 @@
+/*
+* h file for canonical.cpp
+*
+* Puts a tree into a canonical form in place, so that submissions that only
+* differ by variable names or by the order of the operands of a commutative
+* operator become the same tree, with the same structural hashes:
+*   - every variable is renamed after its scope and the order of its first use
+*     in that scope: "$d_0" for the first variable of a scope at depth d to be
+*     used, "$d_1" for the next and so on. Scopes are tracked the way visitNode
+*     tracks them, so shadowing is kept, and numbering each scope on its own
+*     keeps an edit in one block from renaming the variables of the others.
+*     Declared but unused variables come last, in declaration order, and the
+*     declarations at the head of each block are sorted by their new names.
+*   - the operands of +, *, == and != are ordered by their subtree hashes.
+* Function and extern names are left alone. The hashes of the whole tree are
+* recomputed as it goes. Batch runs canonicalize every parsed tree when the
+* hash options include hash_canonical (-H canon).
+*/
+
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include "ast.h"
+
+void canonicalizeTree(astNode* root);
+
+#endif
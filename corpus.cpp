@@ -0,0 +1,374 @@
+/*
+*   MiniC Compiler - Packed Corpus
+*
+*   Purpose: Even with the per-file cache, starting a run over a large corpus means opening and decoding one file
+*   per submission. This file packs the flattened trees of a whole batch into a single file laid out exactly like
+*   the arrays a FlatAstView reads, so a run maps it and starts scoring straight away.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <unordered_map>
+#include "batch.h"
+#include "corpus.h"
+#include "fingerprint.h"
+#include "symbol.h"
+
+static const char CORPUS_MAGIC[4] = {'M', 'C', 'C', 'P'};
+
+// every section starts on this boundary so the mapped arrays are naturally aligned
+static const size_t SECTION_ALIGN = 8;
+
+struct CorpusHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t hashOptions;      // getAstHashOptions() when the subtree hashes were computed
+    uint32_t kgram;            // fingerprint parameters
+    uint32_t window;
+    uint32_t count;            // submissions, one CorpusEntry each
+    uint64_t nodeTotal;        // nodes of all trees together
+    uint64_t fingerprintTotal;
+    uint64_t nameCount;        // distinct identifiers; nameOffset[i] is the pool offset of name i
+    uint64_t poolBytes;
+    // byte offsets of the sections from the start of the file
+    uint64_t tocOffset;
+    uint64_t hashOffset;
+    uint64_t fingerprintOffset;
+    uint64_t childCountOffset;
+    uint64_t sizeOffset;
+    uint64_t valueOffset;
+    uint64_t kindOffset;
+    uint64_t opOffset;
+    uint64_t nameOffset;
+    uint64_t poolOffset;
+    // the LSH band table, laid out by LshIndex::pack
+    uint32_t lshLength;
+    uint32_t lshBands;
+    uint64_t lshSlotCount;
+    uint64_t lshIdCount;
+    uint64_t lshSlotOffset;
+    uint64_t lshIdOffset;
+    uint64_t fileSize;
+};
+
+struct CorpusEntry {
+    uint64_t firstNode;
+    uint64_t firstFingerprint;
+    uint32_t nodeCount;
+    uint32_t fingerprintCount;
+    uint64_t pathOffset; // into the string pool
+};
+
+static uint64_t alignSection(uint64_t offset) {
+    return (offset + SECTION_ALIGN - 1) & ~(uint64_t) (SECTION_ALIGN - 1);
+}
+
+// appends bytes at offset in out, zero filling up to it
+static void putAt(std::string& out, uint64_t offset, const void* data, size_t bytes) {
+    if (out.size() < offset) {
+        out.resize(offset, '\0');
+    }
+    out.append((const char*) data, bytes);
+}
+
+bool writeCorpus(const char* path, const std::vector<Submission>& subs, unsigned lshLength, unsigned lshBands) {
+    CorpusHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+    header.version = CORPUS_VERSION;
+    header.hashOptions = getAstHashOptions();
+    header.kgram = FINGERPRINT_KGRAM;
+    header.window = FINGERPRINT_WINDOW;
+    header.count = (uint32_t) subs.size();
+
+    // gather the arrays of every tree back to back, renumbering names into one corpus-wide table
+    std::vector<CorpusEntry> toc(subs.size());
+    FlatAst all;
+    std::vector<uint64_t> fingerprints;
+    std::unordered_map<int32_t, uint32_t> nameIndex;
+    std::vector<uint64_t> nameOffsets;
+    std::string pool;
+    for (size_t i = 0; i < subs.size(); i++) {
+        const FlatAst& tree = subs[i].flat;
+        CorpusEntry& entry = toc[i];
+        entry.firstNode = all.nodeCount();
+        entry.nodeCount = tree.nodeCount();
+        entry.firstFingerprint = fingerprints.size();
+        entry.fingerprintCount = (uint32_t) subs[i].fingerprints.size();
+        entry.pathOffset = pool.size();
+        pool.append(subs[i].path.c_str(), subs[i].path.size() + 1);
+
+        all.kind.insert(all.kind.end(), tree.kind.begin(), tree.kind.end());
+        all.op.insert(all.op.end(), tree.op.begin(), tree.op.end());
+        all.childCount.insert(all.childCount.end(), tree.childCount.begin(), tree.childCount.end());
+        all.size.insert(all.size.end(), tree.size.begin(), tree.size.end());
+        all.hash.insert(all.hash.end(), tree.hash.begin(), tree.hash.end());
+        for (uint32_t n = 0; n < tree.nodeCount(); n++) {
+            int32_t value = tree.value[n];
+            if (isFlatNamed(tree.kind[n])) {
+                auto found = nameIndex.find(value);
+                if (found == nameIndex.end()) {
+                    found = nameIndex.emplace(value, (uint32_t) nameOffsets.size()).first;
+                    nameOffsets.push_back(pool.size());
+                    const char* name = symbolName((symbol_id) value);
+                    pool.append(name, strlen(name) + 1);
+                }
+                value = (int32_t) found->second;
+            }
+            all.value.push_back(value);
+        }
+        fingerprints.insert(fingerprints.end(), subs[i].fingerprints.begin(), subs[i].fingerprints.end());
+    }
+
+    // the band table of the whole corpus; its ids are the submission indices
+    LshIndex lsh(lshLength, lshBands);
+    for (const Submission& sub : subs) {
+        if (sub.signature.size() == lshLength) {
+            lsh.add(sub.signature);
+        } else {
+            lsh.add(minHashSignature(sub.fingerprints, lshLength));
+        }
+    }
+    std::vector<LshSlot> lshSlots;
+    std::vector<uint32_t> lshIds;
+    lsh.pack(lshSlots, lshIds);
+    header.lshLength = lshLength;
+    header.lshBands = lshBands;
+    header.lshSlotCount = lshSlots.size();
+    header.lshIdCount = lshIds.size();
+    header.nodeTotal = all.nodeCount();
+    header.fingerprintTotal = fingerprints.size();
+    header.nameCount = nameOffsets.size();
+    header.poolBytes = pool.size();
+
+    uint64_t offset = alignSection(sizeof(header));
+    header.tocOffset = offset;
+    offset = alignSection(offset + toc.size() * sizeof(CorpusEntry));
+    header.hashOffset = offset;
+    offset = alignSection(offset + header.nodeTotal * sizeof(uint64_t));
+    header.fingerprintOffset = offset;
+    offset = alignSection(offset + header.fingerprintTotal * sizeof(uint64_t));
+    header.childCountOffset = offset;
+    offset = alignSection(offset + header.nodeTotal * sizeof(uint32_t));
+    header.sizeOffset = offset;
+    offset = alignSection(offset + header.nodeTotal * sizeof(uint32_t));
+    header.valueOffset = offset;
+    offset = alignSection(offset + header.nodeTotal * sizeof(int32_t));
+    header.kindOffset = offset;
+    offset = alignSection(offset + header.nodeTotal);
+    header.opOffset = offset;
+    offset = alignSection(offset + header.nodeTotal);
+    header.nameOffset = offset;
+    offset = alignSection(offset + header.nameCount * sizeof(uint64_t));
+    header.lshSlotOffset = offset;
+    offset = alignSection(offset + header.lshSlotCount * sizeof(LshSlot));
+    header.lshIdOffset = offset;
+    offset = alignSection(offset + header.lshIdCount * sizeof(uint32_t));
+    header.poolOffset = offset;
+    header.fileSize = offset + header.poolBytes;
+
+    std::string out;
+    out.reserve(header.fileSize);
+    putAt(out, 0, &header, sizeof(header));
+    putAt(out, header.tocOffset, toc.data(), toc.size() * sizeof(CorpusEntry));
+    putAt(out, header.hashOffset, all.hash.data(), all.hash.size() * sizeof(uint64_t));
+    putAt(out, header.fingerprintOffset, fingerprints.data(), fingerprints.size() * sizeof(uint64_t));
+    putAt(out, header.childCountOffset, all.childCount.data(), all.childCount.size() * sizeof(uint32_t));
+    putAt(out, header.sizeOffset, all.size.data(), all.size.size() * sizeof(uint32_t));
+    putAt(out, header.valueOffset, all.value.data(), all.value.size() * sizeof(int32_t));
+    putAt(out, header.kindOffset, all.kind.data(), all.kind.size());
+    putAt(out, header.opOffset, all.op.data(), all.op.size());
+    putAt(out, header.nameOffset, nameOffsets.data(), nameOffsets.size() * sizeof(uint64_t));
+    putAt(out, header.lshSlotOffset, lshSlots.data(), lshSlots.size() * sizeof(LshSlot));
+    putAt(out, header.lshIdOffset, lshIds.data(), lshIds.size() * sizeof(uint32_t));
+    putAt(out, header.poolOffset, pool.data(), pool.size());
+
+    // written next to the target and renamed, so a running scorer never maps half a corpus
+    std::string temp = std::string(path) + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "File open error: %s\n", temp.c_str());
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+        ok = rename(temp.c_str(), path) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Cannot write corpus %s\n", path);
+        unlink(temp.c_str());
+    }
+    return ok;
+}
+
+CorpusMapping::CorpusMapping() : base(NULL), length(0), count(0) {
+}
+
+CorpusMapping::~CorpusMapping() {
+    close();
+}
+
+void CorpusMapping::close() {
+    if (base != NULL) {
+        munmap((void*) base, length);
+    }
+    base = NULL;
+    length = 0;
+    count = 0;
+}
+
+// true if [offset, offset + bytes) lies within a file of the given size
+static bool inFile(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+    return offset <= fileSize && bytes <= fileSize - offset;
+}
+
+bool CorpusMapping::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open corpus %s\n", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(CorpusHeader)) {
+        fprintf(stderr, "Not a corpus file: %s\n", path);
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Cannot map corpus %s\n", path);
+        return false;
+    }
+    base = (const char*) mapped;
+    length = st.st_size;
+
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    const char* problem = NULL;
+    if (memcmp(header->magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) != 0 || header->fileSize != length) {
+        problem = "not a corpus file";
+    } else if (header->version != CORPUS_VERSION || header->kgram != FINGERPRINT_KGRAM ||
+               header->window != FINGERPRINT_WINDOW) {
+        problem = "written by another version";
+    } else if (header->hashOptions != getAstHashOptions()) {
+        problem = "written under other hash options (-H)";
+    } else {
+        uint64_t n = header->nodeTotal;
+        bool fits = inFile(header->tocOffset, (uint64_t) header->count * sizeof(CorpusEntry), length) &&
+                    inFile(header->hashOffset, n * sizeof(uint64_t), length) &&
+                    inFile(header->fingerprintOffset, header->fingerprintTotal * sizeof(uint64_t), length) &&
+                    inFile(header->childCountOffset, n * sizeof(uint32_t), length) &&
+                    inFile(header->sizeOffset, n * sizeof(uint32_t), length) &&
+                    inFile(header->valueOffset, n * sizeof(int32_t), length) &&
+                    inFile(header->kindOffset, n, length) && inFile(header->opOffset, n, length) &&
+                    inFile(header->nameOffset, header->nameCount * sizeof(uint64_t), length) &&
+                    inFile(header->lshSlotOffset, header->lshSlotCount * sizeof(LshSlot), length) &&
+                    inFile(header->lshIdOffset, header->lshIdCount * sizeof(uint32_t), length) &&
+                    inFile(header->poolOffset, header->poolBytes, length);
+        // paths are read as C strings, so the pool must end in a NUL
+        fits = fits && (header->poolBytes == 0 || base[header->poolOffset + header->poolBytes - 1] == '\0');
+        const CorpusEntry* toc = (const CorpusEntry*) (base + header->tocOffset);
+        for (uint32_t i = 0; fits && i < header->count; i++) {
+            fits = toc[i].firstNode + toc[i].nodeCount <= n &&
+                   toc[i].firstFingerprint + toc[i].fingerprintCount <= header->fingerprintTotal &&
+                   toc[i].pathOffset < header->poolBytes;
+        }
+        // the band table is probed as a power of two table; its buckets are checked as they are probed
+        fits = fits && header->lshBands > 0 && header->lshBands <= header->lshLength &&
+               (header->lshSlotCount & (header->lshSlotCount - 1)) == 0;
+        if (!fits) {
+            problem = "truncated or corrupt";
+        }
+    }
+    if (problem != NULL) {
+        fprintf(stderr, "Cannot use corpus %s: %s\n", path, problem);
+        close();
+        return false;
+    }
+    count = header->count;
+    return true;
+}
+
+FlatAstView CorpusMapping::tree(size_t i) const {
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    const CorpusEntry& entry = ((const CorpusEntry*) (base + header->tocOffset))[i];
+    FlatAstView view;
+    view.kind = (const uint8_t*) (base + header->kindOffset) + entry.firstNode;
+    view.op = (const uint8_t*) (base + header->opOffset) + entry.firstNode;
+    view.childCount = (const uint32_t*) (base + header->childCountOffset) + entry.firstNode;
+    view.size = (const uint32_t*) (base + header->sizeOffset) + entry.firstNode;
+    view.value = (const int32_t*) (base + header->valueOffset) + entry.firstNode;
+    view.hash = (const uint64_t*) (base + header->hashOffset) + entry.firstNode;
+    view.count = entry.nodeCount;
+    return view;
+}
+
+bool CorpusMapping::checkTree(size_t i) const {
+    if (isWellFormed(tree(i))) {
+        return true;
+    }
+    fprintf(stderr, "Corrupt tree in corpus: %s\n", path(i));
+    return false;
+}
+
+const char* CorpusMapping::path(size_t i) const {
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    const CorpusEntry& entry = ((const CorpusEntry*) (base + header->tocOffset))[i];
+    return base + header->poolOffset + entry.pathOffset;
+}
+
+const uint64_t* CorpusMapping::fingerprints(size_t i) const {
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    const CorpusEntry& entry = ((const CorpusEntry*) (base + header->tocOffset))[i];
+    return (const uint64_t*) (base + header->fingerprintOffset) + entry.firstFingerprint;
+}
+
+uint32_t CorpusMapping::fingerprintCount(size_t i) const {
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    return ((const CorpusEntry*) (base + header->tocOffset))[i].fingerprintCount;
+}
+
+void CorpusMapping::copyTree(size_t i, FlatAst& out) const {
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    const uint64_t* nameOffsets = (const uint64_t*) (base + header->nameOffset);
+    const char* pool = base + header->poolOffset;
+    FlatAstView view = tree(i);
+    uint32_t n = view.nodeCount();
+    out.kind.assign(view.kind, view.kind + n);
+    out.op.assign(view.op, view.op + n);
+    out.childCount.assign(view.childCount, view.childCount + n);
+    out.size.assign(view.size, view.size + n);
+    out.hash.assign(view.hash, view.hash + n);
+    out.value.resize(n);
+    for (uint32_t node = 0; node < n; node++) {
+        int32_t value = view.value[node];
+        // a name index outside the table is left as it is; it cannot match any real name
+        if (isFlatNamed(view.kind[node]) && (uint64_t) value < header->nameCount &&
+            nameOffsets[value] < header->poolBytes) {
+            value = (int32_t) internSymbol(pool + nameOffsets[value]);
+        }
+        out.value[node] = value;
+    }
+}
+
+PackedLshIndex CorpusMapping::lshIndex() const {
+    const CorpusHeader* header = (const CorpusHeader*) base;
+    return PackedLshIndex(header->lshLength, header->lshBands, (const LshSlot*) (base + header->lshSlotOffset),
+                          header->lshSlotCount, (const uint32_t*) (base + header->lshIdOffset), header->lshIdCount,
+                          header->count);
+}
+
+unsigned CorpusMapping::lshLength() const {
+    return ((const CorpusHeader*) base)->lshLength;
+}
+
+unsigned CorpusMapping::lshBands() const {
+    return ((const CorpusHeader*) base)->lshBands;
+}
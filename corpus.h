@@ -0,0 +1,102 @@
+/*
+* h file for corpus.cpp
+*
+* A packed corpus file holds the flattened trees of a whole batch of
+* submissions in one file: a header, a table of contents with one entry per
+* submission, the node arrays of all trees back to back, their fingerprints,
+* and a string pool with the identifier spellings and the submission paths.
+* A CorpusMapping mmaps the file read-only and hands out FlatAstViews straight
+* into the mapping, so loading does no parsing, copying or per-node
+* allocation, and processes scoring the same corpus share its pages.
+*
+* The corpus also stores the LSH band table of the MinHash signatures of its
+* fingerprints (see minhash.h), so one new file is checked against it by
+* probing the stored buckets, without reading the rest of the corpus.
+*
+* Named nodes store an index into the corpus' own name table instead of a
+* symbol id. Names are deduplicated across the whole corpus, so two trees of
+* the same corpus have equal values exactly when their names are spelled the
+* same, which is all the flat passes look at. Trees from different sources
+* must not be compared with each other.
+*/
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "flat_ast.h"
+#include "minhash.h"
+
+// bump whenever the layout or anything stored in it (flattening, hashing, fingerprints) changes
+const uint32_t CORPUS_VERSION = 2;
+
+struct Submission;
+
+/**
+ * Writes the flat trees and fingerprints of subs into a corpus file at path, with the LSH band
+ * table of their signatures of lshLength positions cut into lshBands bands. Every submission must
+ * have its flattened tree and fingerprints; signatures of another length are computed here.
+ * returns: false if the file could not be written.
+ */
+bool writeCorpus(const char* path, const std::vector<Submission>& subs, unsigned lshLength = MINHASH_LENGTH,
+                 unsigned lshBands = MINHASH_BANDS);
+
+class CorpusMapping {
+public:
+    CorpusMapping();
+    ~CorpusMapping();
+
+    CorpusMapping(const CorpusMapping&) = delete;
+    CorpusMapping& operator=(const CorpusMapping&) = delete;
+
+    /**
+     * Maps the corpus at path. Only the header, the table of contents and the bounds of every
+     * section are checked here; a tree's own layout is checked by checkTree, once it is needed.
+     * returns: false, with a message on stderr, if the file is missing, malformed, of another
+     * version or written under other hash options.
+     */
+    bool open(const char* path);
+
+    size_t size() const { return count; }
+
+    // tree i, pointing into the mapping. Nothing may read it before checkTree(i) passed
+    FlatAstView tree(size_t i) const;
+
+    /**
+     * Checks that the child counts and sizes of tree i lay out a valid tree (see isWellFormed),
+     * so the flat passes cannot be led outside the mapping by a corrupt file.
+     * returns: false, with a message on stderr, if they do not.
+     */
+    bool checkTree(size_t i) const;
+
+    // path of submission i as it was when the corpus was written
+    const char* path(size_t i) const;
+
+    // fingerprints of submission i
+    const uint64_t* fingerprints(size_t i) const;
+    uint32_t fingerprintCount(size_t i) const;
+
+    /**
+     * Copies tree i out of the mapping with its names interned again as symbol ids, so that it
+     * can be compared with trees parsed by this process. Like tree, only once checkTree(i) passed.
+     */
+    void copyTree(size_t i, FlatAst& out) const;
+
+    // the stored band table; its ids are submission indices
+    PackedLshIndex lshIndex() const;
+
+    // signature length and band count the band table was built with
+    unsigned lshLength() const;
+    unsigned lshBands() const;
+
+private:
+    void close();
+
+    const char* base;
+    size_t length;
+    size_t count;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+*   MiniC Compiler - Fingerprint Index
+*
+*   Purpose: Scoring every pair of N submissions is N^2 tree comparisons, which stops being practical past a few
+*   thousand files. Almost all of those pairs have nothing in common. This file reduces each tree to a small set of
+*   winnowed k-gram fingerprints and finds, through an inverted index, the pairs that share enough of them to be worth
+*   a full comparison.
+*/
+
+#include <algorithm>
+#include <mutex>
+#include "fingerprint.h"
+#include "thread_pool.h"
+
+// rows of the pair search handed to one pool task
+static const size_t CANDIDATE_CHUNK = 64;
+
+// odd multiplier of the rolling k-gram hash
+static const uint64_t KGRAM_BASE = 0x100000001b3ULL;
+
+// splitmix64 finalizer, so that the minimum of a window is not biased towards small token values
+static uint64_t mixFingerprint(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void linearizeTree(const FlatAstView& tree, std::vector<uint32_t>& tokens) {
+    tokens.reserve(tokens.size() + tree.nodeCount());
+    for (uint32_t i = 0; i < tree.nodeCount(); i++) {
+        tokens.push_back((uint32_t) tree.kind[i] | ((uint32_t) tree.op[i] << 8));
+    }
+}
+
+std::vector<uint64_t> winnowFingerprints(const std::vector<uint32_t>& tokens, unsigned k, unsigned w) {
+    std::vector<uint64_t> fingerprints;
+    if (tokens.empty()) {
+        return fingerprints;
+    }
+    if (k == 0) {
+        k = 1;
+    }
+    if (w == 0) {
+        w = 1;
+    }
+
+    // hash every k-gram with a polynomial rolling hash (arithmetic wraps mod 2^64)
+    std::vector<uint64_t> grams;
+    if (tokens.size() < k) {
+        uint64_t h = 0;
+        for (uint32_t token : tokens) {
+            h = h * KGRAM_BASE + token + 1;
+        }
+        grams.push_back(mixFingerprint(h));
+    } else {
+        uint64_t top = 1; // KGRAM_BASE^(k-1)
+        for (unsigned i = 1; i < k; i++) {
+            top *= KGRAM_BASE;
+        }
+        uint64_t h = 0;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (i >= k) {
+                h -= (tokens[i - k] + 1) * top;
+            }
+            h = h * KGRAM_BASE + tokens[i] + 1;
+            if (i + 1 >= k) {
+                grams.push_back(mixFingerprint(h));
+            }
+        }
+    }
+
+    // robust winnowing: the rightmost minimum of each window, recorded once per position
+    size_t windows = grams.size() >= w ? grams.size() - w + 1 : 1;
+    size_t span = std::min<size_t>(w, grams.size());
+    size_t chosen = SIZE_MAX;
+    for (size_t start = 0; start < windows; start++) {
+        size_t best = start;
+        for (size_t i = start + 1; i < start + span; i++) {
+            if (grams[i] <= grams[best]) {
+                best = i;
+            }
+        }
+        if (best != chosen) {
+            fingerprints.push_back(grams[best]);
+            chosen = best;
+        }
+    }
+
+    std::sort(fingerprints.begin(), fingerprints.end());
+    fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+    return fingerprints;
+}
+
+std::vector<uint64_t> fingerprintTree(const FlatAstView& tree, unsigned k, unsigned w) {
+    std::vector<uint32_t> tokens;
+    linearizeTree(tree, tokens);
+    return winnowFingerprints(tokens, k, w);
+}
+
+void FingerprintIndex::add(uint32_t id, const std::vector<uint64_t>& fingerprints) {
+    for (uint64_t fingerprint : fingerprints) {
+        postings[fingerprint].push_back(id);
+    }
+    if (documents.size() <= id) {
+        documents.resize(id + 1);
+    }
+    documents[id] = fingerprints;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> FingerprintIndex::candidatePairs(double minOverlap, size_t maxDocFrequency,
+                                                                            unsigned threads) const {
+    size_t n = documentCount();
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::mutex pairsLock;
+
+    WorkStealingPool pool(threads);
+    for (size_t first = 0; first < n; first += CANDIDATE_CHUNK) {
+        pool.submit([this, first, n, minOverlap, maxDocFrequency, &pairs, &pairsLock](unsigned) {
+            // shared[j] counts the fingerprints row i has in common with document j > i. Only the
+            // touched entries are reset, so a row costs its posting lists and not O(n)
+            std::vector<uint32_t> shared(n, 0);
+            std::vector<uint32_t> touched;
+            std::vector<std::pair<uint32_t, uint32_t>> found;
+            size_t last = std::min(n, first + CANDIDATE_CHUNK);
+            for (size_t i = first; i < last; i++) {
+                for (uint64_t fingerprint : documents[i]) {
+                    const std::vector<uint32_t>& docs = postings.find(fingerprint)->second;
+                    if (maxDocFrequency != 0 && docs.size() > maxDocFrequency) {
+                        continue;
+                    }
+                    // postings are in increasing id order, so the documents after i are a suffix
+                    auto it = std::upper_bound(docs.begin(), docs.end(), (uint32_t) i);
+                    for (; it != docs.end(); ++it) {
+                        if (shared[*it]++ == 0) {
+                            touched.push_back(*it);
+                        }
+                    }
+                }
+                for (uint32_t j : touched) {
+                    size_t smaller = std::min(documents[i].size(), documents[j].size());
+                    if (smaller > 0 && shared[j] >= minOverlap * smaller) {
+                        found.push_back(std::make_pair((uint32_t) i, j));
+                    }
+                    shared[j] = 0;
+                }
+                touched.clear();
+            }
+            std::lock_guard<std::mutex> guard(pairsLock);
+            pairs.insert(pairs.end(), found.begin(), found.end());
+        });
+    }
+    pool.wait();
+
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+std::vector<uint32_t> FingerprintIndex::candidatesBefore(uint32_t id, double minOverlap, size_t maxDocFrequency) const {
+    std::vector<uint32_t> shared(id, 0);
+    std::vector<uint32_t> touched;
+    for (uint64_t fingerprint : documents[id]) {
+        const std::vector<uint32_t>& docs = postings.find(fingerprint)->second;
+        if (maxDocFrequency != 0 && docs.size() > maxDocFrequency) {
+            continue;
+        }
+        // the documents before id are a prefix of the posting list
+        for (auto it = docs.begin(); it != docs.end() && *it < id; ++it) {
+            if (shared[*it]++ == 0) {
+                touched.push_back(*it);
+            }
+        }
+    }
+    std::vector<uint32_t> found;
+    for (uint32_t i : touched) {
+        size_t smaller = std::min(documents[i].size(), documents[id].size());
+        if (smaller > 0 && shared[i] >= minOverlap * smaller) {
+            found.push_back(i);
+        }
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
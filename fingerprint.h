@@ -0,0 +1,77 @@
+/*
+* h file for fingerprint.cpp
+*
+* Winnowed k-gram fingerprints of an AST and an inverted index over them. A
+* tree is linearized into its pre-order stream of node kinds, every k
+* consecutive kinds are hashed, and winnowing keeps the minimum hash of each
+* window of w k-grams. Two submissions that share a run of at least k + w - 1
+* nodes are guaranteed to share a fingerprint, so the index only has to
+* look at submissions with overlapping fingerprint sets.
+*/
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "flat_ast.h"
+
+// defaults for the k-gram length and the winnowing window
+const unsigned FINGERPRINT_KGRAM = 8;
+const unsigned FINGERPRINT_WINDOW = 4;
+
+/**
+ * Appends one token per node of tree, in pre-order. A token is the node kind plus its
+ * operator, so names and constants do not take part.
+ */
+void linearizeTree(const FlatAstView& tree, std::vector<uint32_t>& tokens);
+
+/**
+ * Winnows the k-gram hashes of tokens with a window of w k-grams.
+ * Streams shorter than one k-gram produce a single fingerprint of the whole stream.
+ * returns: the fingerprints, sorted and without duplicates.
+ */
+std::vector<uint64_t> winnowFingerprints(const std::vector<uint32_t>& tokens, unsigned k = FINGERPRINT_KGRAM,
+                                         unsigned w = FINGERPRINT_WINDOW);
+
+// linearizeTree followed by winnowFingerprints
+std::vector<uint64_t> fingerprintTree(const FlatAstView& tree, unsigned k = FINGERPRINT_KGRAM,
+                                      unsigned w = FINGERPRINT_WINDOW);
+
+/**
+ * Maps every fingerprint to the documents it occurs in. Documents are numbered
+ * densely by the caller, in the order they are added.
+ */
+class FingerprintIndex {
+public:
+    // adds document id with its sorted, duplicate free fingerprints; ids must be added in increasing order
+    void add(uint32_t id, const std::vector<uint64_t>& fingerprints);
+
+    size_t documentCount() const { return documents.size(); }
+
+    /**
+     * Finds every pair (i, j), i < j, whose shared fingerprints make up at least
+     * minOverlap of the smaller of the two fingerprint sets.
+     * @param maxDocFrequency: fingerprints found in more documents than this are treated as
+     * boilerplate and ignored, so one common idiom cannot turn the search quadratic. 0 means no limit.
+     * @param threads is the number of threads to spread the documents over, 0 = one per hardware thread.
+     * returns: the candidate pairs sorted by (i, j).
+     */
+    std::vector<std::pair<uint32_t, uint32_t>> candidatePairs(double minOverlap, size_t maxDocFrequency,
+                                                              unsigned threads = 0) const;
+
+    /**
+     * The documents i < id that candidatePairs pairs with id, found from id's posting lists alone.
+     * returns: the ids in increasing order.
+     */
+    std::vector<uint32_t> candidatesBefore(uint32_t id, double minOverlap, size_t maxDocFrequency) const;
+
+private:
+    std::unordered_map<uint64_t, std::vector<uint32_t>> postings; // fingerprint -> ids, in increasing order
+    std::vector<std::vector<uint64_t>> documents;                 // each document's fingerprints
+};
+
+#endif
@@ -0,0 +1,608 @@
+/*
+*   MiniC Compiler - Flattened AST
+*
+*   Purpose: ast_Node is a fat union reached through pointers and blocks keep a separately allocated vector, so every
+*   step of compare() or visitNode() lands on a random address. This file copies a tree into a pre-order
+*   struct-of-arrays layout with 32-bit indices and implements the comparison and semantic analysis passes over it,
+*   which keeps the all-pairs working set small enough to stay in cache.
+*/
+
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "flat_ast.h"
+#include "inclass.h"
+#include "metrics.h"
+#include "scoped_symbol_table.h"
+#include "sequence_align.h"
+
+/* flattening */
+
+// one pending step of a flattening: a subtree to append, or the node at index to close once its subtree is in
+struct FlattenStep {
+    astNode* node;
+    uint32_t index;
+    bool close;
+};
+
+// pending steps of the flattenings on this thread, the next one last
+static thread_local std::vector<FlattenStep> flattenSteps;
+
+struct Flattener {
+    FlatAst& out;
+
+    explicit Flattener(FlatAst& out) : out(out) {}
+
+    // appends a node and returns its index; size is patched once the children are in
+    uint32_t open(flat_kind kind, uint8_t op, uint32_t children, int32_t value, uint64_t hash) {
+        uint32_t index = out.nodeCount();
+        out.kind.push_back(kind);
+        out.op.push_back(op);
+        out.childCount.push_back(children);
+        out.size.push_back(1);
+        out.value.push_back(value);
+        out.hash.push_back(hash);
+        return index;
+    }
+
+    void close(uint32_t index) {
+        out.size[index] = out.nodeCount() - index;
+    }
+
+    // appends the node itself, leaving its children to the caller
+    uint32_t openNode(astNode* node) {
+        switch (node->type) {
+            case ast_prog:
+                return open(flat_prog, 0, 3, 0, node->hash);
+            case ast_func:
+                return open(flat_func, 0, 2, (int32_t) node->func.name, node->hash);
+            case ast_extern:
+                return open(flat_extern, 0, 0, (int32_t) node->ext.name, node->hash);
+            case ast_var:
+                return open(flat_var, 0, 0, (int32_t) node->var.name, node->hash);
+            case ast_cnst:
+                return open(flat_cnst, 0, 0, node->cnst.value, node->hash);
+            case ast_rexpr:
+                return open(flat_rexpr, node->rexpr.op, 2, 0, node->hash);
+            case ast_bexpr:
+                return open(flat_bexpr, node->bexpr.op, 2, 0, node->hash);
+            case ast_uexpr:
+                return open(flat_uexpr, node->uexpr.op, 1, 0, node->hash);
+            case ast_stmt:
+                return openStmt(node);
+            default:
+                fprintf(stderr, "Incorrect node type\n");
+                exit(1);
+        }
+    }
+
+    uint32_t openStmt(astNode* node) {
+        switch (node->stmt.type) {
+            case ast_call:
+                return open(flat_call, 0, 1, (int32_t) node->stmt.call.name, node->hash);
+            case ast_ret:
+                return open(flat_ret, 0, 1, 0, node->hash);
+            case ast_block:
+                return open(flat_block, 0, (uint32_t) node->stmt.block.stmt_list->size(), 0, node->hash);
+            case ast_while:
+                return open(flat_while, 0, 2, 0, node->hash);
+            case ast_if:
+                return open(flat_if, 0, 3, 0, node->hash);
+            case ast_asgn:
+                return open(flat_asgn, 0, 2, 0, node->hash);
+            case ast_decl:
+                return open(flat_decl, 0, 0, (int32_t) node->stmt.decl.name, node->hash);
+            default:
+                fprintf(stderr, "Incorrect node type\n");
+                exit(1);
+        }
+    }
+
+    // appends root in pre-order. Walks with an explicit stack, as nesting is unbounded
+    void add(astNode* root) {
+        std::vector<FlattenStep>& steps = flattenSteps;
+        size_t base = steps.size();
+        steps.push_back({root, 0, false});
+        while (steps.size() > base) {
+            FlattenStep step = steps.back();
+            steps.pop_back();
+            if (step.close) {
+                close(step.index);
+                continue;
+            }
+            if (step.node == NULL) {
+                open(flat_none, 0, 0, 0, FLAT_NONE_HASH);
+                continue;
+            }
+            uint32_t index = openNode(step.node);
+            if (out.childCount[index] == 0) {
+                continue;
+            }
+            steps.push_back({NULL, index, true});
+            // children are pushed in source order and reversed, so they are appended in source order
+            size_t first = steps.size();
+            forEachChild(step.node, [&steps](astNode* child) {
+                steps.push_back({child, 0, false});
+            });
+            std::reverse(steps.begin() + first, steps.end());
+        }
+    }
+};
+
+void flattenTree(astNode* root, FlatAst& out) {
+    out = FlatAst();
+    Flattener flattener(out);
+    flattener.add(root);
+}
+
+/* unflattening */
+
+// subtrees built by the unflattenings on this thread whose parent is not built yet
+static thread_local std::vector<astNode*> unflattenStack;
+
+// takes the next child of the node being built off the stack
+static astNode* popChild(std::vector<astNode*>& built) {
+    astNode* child = built.back();
+    built.pop_back();
+    return child;
+}
+
+// builds the node at index from its children, which are on top of built, first child last
+static astNode* unflattenOne(const FlatAst& tree, uint32_t index, std::vector<astNode*>& built) {
+    symbol_id name = (symbol_id) tree.value[index];
+    switch (tree.kind[index]) {
+        case flat_none:
+            return NULL;
+        case flat_prog: {
+            astNode* ext1 = popChild(built);
+            astNode* ext2 = popChild(built);
+            return createProg(ext1, ext2, popChild(built));
+        }
+        case flat_func: {
+            astNode* param = popChild(built);
+            return createFunc(name, param, popChild(built));
+        }
+        case flat_extern:
+            return createExtern(name);
+        case flat_var:
+            return createVar(name);
+        case flat_cnst:
+            return createCnst(tree.value[index]);
+        case flat_rexpr: {
+            astNode* lhs = popChild(built);
+            return createRExpr(lhs, popChild(built), (rop_type) tree.op[index]);
+        }
+        case flat_bexpr: {
+            astNode* lhs = popChild(built);
+            return createBExpr(lhs, popChild(built), (op_type) tree.op[index]);
+        }
+        case flat_uexpr:
+            return createUExpr(popChild(built), (op_type) tree.op[index]);
+        case flat_call:
+            return createCall(name, popChild(built));
+        case flat_ret:
+            return createRet(popChild(built));
+        case flat_block: {
+            vector<astNode*>* list = new vector<astNode*>();
+            list->reserve(tree.childCount[index]);
+            for (uint32_t k = 0; k < tree.childCount[index]; k++) {
+                list->push_back(popChild(built));
+            }
+            return createBlock(list);
+        }
+        case flat_while: {
+            astNode* cond = popChild(built);
+            return createWhile(cond, popChild(built));
+        }
+        case flat_if: {
+            astNode* cond = popChild(built);
+            astNode* ifBody = popChild(built);
+            return createIf(cond, ifBody, popChild(built));
+        }
+        case flat_asgn: {
+            astNode* lhs = popChild(built);
+            return createAsgn(lhs, popChild(built));
+        }
+        case flat_decl:
+            return createDecl(name);
+        default:
+            fprintf(stderr, "Incorrect node type\n");
+            exit(1);
+    }
+}
+
+// Builds the subtree at index; placeholders come back as NULL children. Walking its pre-order range backwards
+// reaches each node after all of its children, which are then on top of the stack in source order, so the tree is
+// built bottom-up without recursing
+static astNode* unflattenNode(const FlatAst& tree, uint32_t index) {
+    std::vector<astNode*>& built = unflattenStack;
+    for (uint32_t i = index + tree.size[index]; i-- > index;) {
+        astNode* node = unflattenOne(tree, i, built);
+        built.push_back(node);
+    }
+    return popChild(built);
+}
+
+astNode* unflattenTree(const FlatAst& tree) {
+    if (tree.nodeCount() == 0) {
+        return NULL;
+    }
+    return unflattenNode(tree, 0);
+}
+
+// number of child slots of each flat_kind, -1 for blocks
+static const int FLAT_ARITY[] = {0, 3, 2, 0, 0, 0, 2, 2, 1, 1, 1, -1, 2, 3, 2, 0};
+
+bool isWellFormed(const FlatAst& tree) {
+    uint32_t n = tree.nodeCount();
+    if (tree.op.size() != n || tree.childCount.size() != n || tree.size.size() != n || tree.value.size() != n ||
+        tree.hash.size() != n) {
+        return false;
+    }
+    return isWellFormed(FlatAstView(tree));
+}
+
+bool isWellFormed(const FlatAstView& tree) {
+    uint32_t n = tree.nodeCount();
+    if (n > 0 && tree.size[0] != n) {
+        return false;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (tree.kind[i] > flat_decl || tree.size[i] == 0 || tree.size[i] > n - i) {
+            return false;
+        }
+        if (FLAT_ARITY[tree.kind[i]] >= 0 && tree.childCount[i] != (uint32_t) FLAT_ARITY[tree.kind[i]]) {
+            return false;
+        }
+        // the children must tile the rest of the subtree exactly
+        uint32_t end = i + tree.size[i];
+        uint32_t child = i + 1;
+        for (uint32_t k = 0; k < tree.childCount[i]; k++) {
+            if (child >= end) {
+                return false;
+            }
+            child += tree.size[child];
+        }
+        if (child != end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* comparison */
+
+// the node_type a flat kind came from, so type mismatches are judged exactly as compare() does
+static int flatNodeType(uint8_t kind) {
+    return isFlatStmt(kind) ? (int) flat_call : (int) kind;
+}
+
+// returns the index of the k-th child of node
+static uint32_t flatChild(const FlatAstView& tree, uint32_t node, uint32_t k) {
+    uint32_t child = node + 1;
+    for (uint32_t n = 0; n < k; n++) {
+        child = tree.nextSibling(child);
+    }
+    return child;
+}
+
+// names are interned symbols, so equal names have equal values in any two trees
+static bool sameName(const FlatAstView& tree1, uint32_t node1, const FlatAstView& tree2, uint32_t node2) {
+    return tree1.value[node1] == tree2.value[node2];
+}
+
+static bool sameParam(const FlatAstView& tree1, uint32_t param1, const FlatAstView& tree2, uint32_t param2) {
+    if (tree1.kind[param1] == flat_none || tree2.kind[param2] == flat_none) {
+        return tree1.kind[param1] == tree2.kind[param2];
+    }
+    return sameName(tree1, param1, tree2, param2);
+}
+
+// Pairs of node indices compareFlat still has to visit, next pair last; the counterpart of pairStack in inclass.cpp
+static thread_local std::vector<AlignedPair> flatPairStack;
+
+// Per-thread scratch for compareFlatBlocks, like the one compareBlocks in inclass.cpp uses, plus the statements'
+// node indices so positions inside a block can be turned back into nodes
+static thread_local std::vector<uint64_t> flatKeys1, flatKeys2;
+static thread_local std::vector<uint32_t> flatStmts;
+static thread_local std::vector<AlignedPair> flatMatches;
+
+// the flat counterpart of scoreCutoff in inclass.cpp
+static thread_local int flatScoreCutoff = INT_MIN;
+
+// aligns the two statement lists exactly like compareBlocks does and pushes the pairs to compare in statement order
+static int compareFlatBlocks(const FlatAstView& tree1, uint32_t block1, const FlatAstView& tree2, uint32_t block2, int score) {
+    uint32_t n = tree1.childCount[block1];
+    uint32_t m = tree2.childCount[block2];
+    flatKeys1.clear();
+    flatKeys2.clear();
+    flatStmts.clear();
+    for (uint32_t i = 0, child = block1 + 1; i < n; i++, child = tree1.nextSibling(child)) {
+        flatKeys1.push_back(tree1.hash[child]);
+        flatStmts.push_back(child);
+    }
+    for (uint32_t j = 0, child = block2 + 1; j < m; j++, child = tree2.nextSibling(child)) {
+        flatKeys2.push_back(tree2.hash[child]);
+        flatStmts.push_back(child);
+    }
+    flatMatches.clear();
+    alignSequences(flatKeys1.data(), n, flatKeys2.data(), m, flatMatches);
+    size_t anchors = flatMatches.size();
+
+    // statement i of block1 is flatStmts[i], statement j of block2 is flatStmts[n + j]
+    size_t first = flatPairStack.size();
+    uint32_t next1 = 0, next2 = 0;
+    for (size_t a = 0; a <= anchors; a++) {
+        uint32_t end1 = a < anchors ? flatMatches[a].first : n;
+        uint32_t end2 = a < anchors ? flatMatches[a].second : m;
+        uint32_t gap1 = end1 - next1, gap2 = end2 - next2;
+        for (uint32_t i = 0; i < std::min(gap1, gap2); i++) {
+            flatPairStack.push_back({flatStmts[next1 + i], flatStmts[n + next2 + i]});
+        }
+        score -= LENGTH_MISMATCH_DEDUCTOR * abs((int) gap1 - (int) gap2);
+        if (a < anchors) {
+            flatPairStack.push_back({flatStmts[end1], flatStmts[n + end2]});
+        }
+        next1 = end1 + 1;
+        next2 = end2 + 1;
+    }
+    std::reverse(flatPairStack.begin() + first, flatPairStack.end());
+    return score;
+}
+
+// pushes the pairs of the first count children of node1 and node2, last pair first
+static void pushFlatChildren(const FlatAstView& tree1, uint32_t node1, const FlatAstView& tree2, uint32_t node2,
+                             uint32_t count) {
+    size_t first = flatPairStack.size();
+    uint32_t child1 = node1 + 1, child2 = node2 + 1;
+    for (uint32_t k = 0; k < count; k++) {
+        flatPairStack.push_back({child1, child2});
+        child1 = tree1.nextSibling(child1);
+        child2 = tree2.nextSibling(child2);
+    }
+    std::reverse(flatPairStack.begin() + first, flatPairStack.end());
+}
+
+// the flat counterpart of comparePair: scores one pair of nodes and pushes the pairs of children to compare
+static int compareFlatPair(const FlatAstView& tree1, uint32_t node1, const FlatAstView& tree2, uint32_t node2, int score) {
+    uint8_t kind1 = tree1.kind[node1];
+    uint8_t kind2 = tree2.kind[node2];
+    if (kind1 == flat_none and kind2 == flat_none) {
+        return score;
+    }
+    if (kind1 == flat_none or kind2 == flat_none) {
+        return score - NULL_NODE_DEDUCTOR;
+    }
+    if (flatNodeType(kind1) != flatNodeType(kind2)) {
+        return score - TYPE_MISMATCH_DEDUCTOR;
+    }
+    // identical subtrees cost nothing; see compare()
+    if ((getAstHashOptions() & hash_names) and tree1.hash[node1] == tree2.hash[node2] and tree1.size[node1] == tree2.size[node2]) {
+        return score;
+    }
+
+    switch (kind1) {
+        case flat_prog:
+            flatPairStack.push_back({flatChild(tree1, node1, 2), flatChild(tree2, node2, 2)});
+            return score;
+        case flat_func: {
+            uint32_t param1 = node1 + 1, param2 = node2 + 1;
+            if (!sameParam(tree1, param1, tree2, param2)) {
+                score -= PARAM_MISMATCH_DEDUCTOR;
+            }
+            flatPairStack.push_back({tree1.nextSibling(param1), tree2.nextSibling(param2)});
+            return score;
+        }
+        case flat_block:
+            if (kind2 == flat_block) {
+                return compareFlatBlocks(tree1, node1, tree2, node2, score);
+            }
+            return score;
+        case flat_decl:
+            if (kind2 == flat_decl and !sameName(tree1, node1, tree2, node2)) {
+                return score - DECL_NAME_MISMATCH_DEDUCTOR;
+            }
+            return score;
+        case flat_var:
+            if (!sameName(tree1, node1, tree2, node2)) {
+                return score - NAME_MISMATCH_DEDUCTOR;
+            }
+            return score;
+        case flat_rexpr:
+        case flat_bexpr:
+            pushFlatChildren(tree1, node1, tree2, node2, 2);
+            return score;
+        case flat_uexpr:
+            pushFlatChildren(tree1, node1, tree2, node2, 1);
+            return score;
+        case flat_call:
+        case flat_ret:
+        case flat_while:
+        case flat_if:
+        case flat_asgn:
+            // statements of the same kind have the same child slots, compared pairwise
+            if (kind2 == kind1) {
+                pushFlatChildren(tree1, node1, tree2, node2, tree1.childCount[node1]);
+            }
+            return score;
+        default:
+            // externs and constants do not change the score
+            return score;
+    }
+}
+
+static int compareFlat(const FlatAstView& tree1, uint32_t node1, const FlatAstView& tree2, uint32_t node2, int score) {
+    size_t base = flatPairStack.size();
+    uint64_t visited = 0;
+    flatPairStack.push_back({node1, node2});
+    while (flatPairStack.size() > base) {
+        if (score < flatScoreCutoff) {
+            flatPairStack.resize(base);
+            METRIC_COUNT(counter_early_exits, 1);
+            break;
+        }
+        AlignedPair next = flatPairStack.back();
+        flatPairStack.pop_back();
+        score = compareFlatPair(tree1, next.first, tree2, next.second, score);
+        visited++;
+    }
+    METRIC_COUNT(counter_nodes_compared, visited);
+    return score;
+}
+
+int compareFlatTrees(const FlatAstView& tree1, const FlatAstView& tree2) {
+    if (tree1.nodeCount() == 0 or tree2.nodeCount() == 0) {
+        return tree1.nodeCount() == tree2.nodeCount() ? 100 : 100 - NULL_NODE_DEDUCTOR;
+    }
+    return compareFlat(tree1, 0, tree2, 0, 100);
+}
+
+// the same bound scoreUpperBound in inclass.cpp takes from the parameters and function body lengths
+static int flatScoreUpperBound(const FlatAstView& tree1, const FlatAstView& tree2) {
+    int bound = 100;
+    if (tree1.nodeCount() == 0 or tree2.nodeCount() == 0 or tree1.kind[0] != flat_prog or tree2.kind[0] != flat_prog) {
+        return bound;
+    }
+    uint32_t func1 = flatChild(tree1, 0, 2), func2 = flatChild(tree2, 0, 2);
+    if (tree1.kind[func1] != flat_func or tree2.kind[func2] != flat_func) {
+        return bound;
+    }
+    if (!sameParam(tree1, func1 + 1, tree2, func2 + 1)) {
+        bound -= PARAM_MISMATCH_DEDUCTOR;
+    }
+    uint32_t body1 = tree1.nextSibling(func1 + 1), body2 = tree2.nextSibling(func2 + 1);
+    if (tree1.kind[body1] == flat_block and tree2.kind[body2] == flat_block) {
+        bound -= LENGTH_MISMATCH_DEDUCTOR * abs((int) tree1.childCount[body1] - (int) tree2.childCount[body2]);
+    }
+    return bound;
+}
+
+int compareFlatTreesBounded(const FlatAstView& tree1, const FlatAstView& tree2, int minScore) {
+    if (tree1.nodeCount() == 0 or tree2.nodeCount() == 0) {
+        return compareFlatTrees(tree1, tree2);
+    }
+    int bound = flatScoreUpperBound(tree1, tree2);
+    if (bound < minScore) {
+        METRIC_COUNT(counter_early_exits, 1);
+        return bound;
+    }
+    flatScoreCutoff = minScore;
+    int score = compareFlat(tree1, 0, tree2, 0, 100);
+    flatScoreCutoff = INT_MIN;
+    return score;
+}
+
+/* semantic analysis */
+
+// one pending step of an analysis: a node to visit, or the scope node opened to close
+struct AnalyzeStep {
+    uint32_t node;
+    bool closeScope;
+};
+
+// pending steps of the analyses on this thread, the next one last
+static thread_local std::vector<AnalyzeStep> analyzeSteps;
+
+struct FlatAnalyzer {
+    const FlatAst& tree;
+    std::vector<std::string>& errors;
+    ScopedSymbolTable symbols;
+
+    FlatAnalyzer(const FlatAst& tree, std::vector<std::string>& errors) : tree(tree), errors(errors) {}
+
+    void declare(uint32_t node) {
+        symbol_id name = (symbol_id) tree.value[node];
+        if (!symbols.declare(name)) {
+            errors.push_back(std::string("Variable has already been declared: '") + symbolName(name) + "'");
+        }
+    }
+
+    void use(uint32_t node) {
+        symbol_id name = (symbol_id) tree.value[node];
+        if (!symbols.isDeclared(name)) {
+            errors.push_back(std::string("Variable has not been declared. '") + symbolName(name) + "'");
+        }
+    }
+
+    // queues the children of node so they are visited in source order
+    void pushChildren(uint32_t node) {
+        std::vector<AnalyzeStep>& steps = analyzeSteps;
+        size_t first = steps.size();
+        uint32_t child = node + 1;
+        for (uint32_t k = 0; k < tree.childCount[node]; k++) {
+            steps.push_back({child, false});
+            child = tree.nextSibling(child);
+        }
+        std::reverse(steps.begin() + first, steps.end());
+    }
+
+    void visit(uint32_t node) {
+        std::vector<AnalyzeStep>& steps = analyzeSteps;
+        switch (tree.kind[node]) {
+            case flat_func: {
+                // the parameter and the body's declarations share one scope
+                uint32_t param = node + 1;
+                symbols.pushScope();
+                if (tree.kind[param] != flat_none) {
+                    symbols.declare((symbol_id) tree.value[param]);
+                }
+                steps.push_back({node, true});
+                uint32_t body = tree.nextSibling(param);
+                if (tree.kind[body] == flat_block) {
+                    pushChildren(body);
+                } else {
+                    steps.push_back({body, false});
+                }
+                break;
+            }
+            case flat_block:
+                symbols.pushScope();
+                steps.push_back({node, true});
+                pushChildren(node);
+                break;
+            case flat_decl:
+                if (symbols.depth() > 0) {
+                    declare(node);
+                }
+                break;
+            case flat_var:
+                use(node);
+                break;
+            case flat_asgn:
+                // the right hand side is checked before the variable assigned to
+                steps.push_back({node + 1, false});
+                steps.push_back({tree.nextSibling(node + 1), false});
+                break;
+            default:
+                pushChildren(node);
+                break;
+        }
+    }
+
+    // checks the subtree at root. Walks with an explicit stack, as nesting is unbounded
+    void walk(uint32_t root) {
+        std::vector<AnalyzeStep>& steps = analyzeSteps;
+        size_t base = steps.size();
+        steps.push_back({root, false});
+        while (steps.size() > base) {
+            AnalyzeStep step = steps.back();
+            steps.pop_back();
+            if (step.closeScope) {
+                symbols.popScope();
+            } else {
+                visit(step.node);
+            }
+        }
+    }
+};
+
+bool analyzeFlatTree(const FlatAst& tree, std::vector<std::string>& errors) {
+    size_t before = errors.size();
+    if (tree.nodeCount() > 0) {
+        FlatAnalyzer analyzer(tree, errors);
+        analyzer.walk(0);
+    }
+    return errors.size() == before;
+}
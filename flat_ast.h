@@ -0,0 +1,123 @@
+/*
+* h file for flat_ast.cpp
+*
+* A FlatAst is a pointer-free copy of an AST laid out in pre-order over
+* parallel arrays. Node i's first child is i + 1 and its next sibling is
+* i + size[i], so walking a tree is a linear scan through a few contiguous
+* arrays instead of a chase through scattered heap nodes.
+*
+* Every node kind except blocks has a fixed number of child slots. An absent
+* optional child (a function without a parameter, "return;", an if without an
+* else, read()) is stored as a flat_none placeholder so the slots line up.
+*/
+
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ast.h"
+
+typedef enum : uint8_t {
+		flat_none, // placeholder for an absent optional child
+		flat_prog,
+		flat_func,
+		flat_extern,
+		flat_var,
+		flat_cnst,
+		flat_rexpr,
+		flat_bexpr,
+		flat_uexpr,
+		flat_call, // statement kinds from here on
+		flat_ret,
+		flat_block,
+		flat_while,
+		flat_if,
+		flat_asgn,
+		flat_decl
+	} flat_kind;
+
+struct FlatAst {
+    std::vector<uint8_t> kind;        // flat_kind of each node
+    std::vector<uint8_t> op;          // op_type or rop_type for expressions, 0 otherwise
+    std::vector<uint32_t> childCount; // number of children
+    std::vector<uint32_t> size;       // number of nodes in the subtree rooted here, including itself
+    std::vector<int32_t> value;       // constant value, or symbol_id for named nodes
+    std::vector<uint64_t> hash;       // structural hash copied from the pointer tree, FLAT_NONE_HASH for placeholders
+
+    uint32_t nodeCount() const { return (uint32_t) kind.size(); }
+    uint32_t nextSibling(uint32_t node) const { return node + size[node]; }
+};
+
+/**
+ * Read-only view of a flat tree's arrays, wherever they live: in a FlatAst or in a
+ * memory-mapped corpus (see corpus.h). The passes over flat trees take views, so both
+ * kinds of storage are scored by the same code.
+ */
+struct FlatAstView {
+    const uint8_t* kind = NULL;
+    const uint8_t* op = NULL;
+    const uint32_t* childCount = NULL;
+    const uint32_t* size = NULL;
+    const int32_t* value = NULL;
+    const uint64_t* hash = NULL;
+    uint32_t count = 0;
+
+    FlatAstView() {}
+    FlatAstView(const FlatAst& tree)
+        : kind(tree.kind.data()), op(tree.op.data()), childCount(tree.childCount.data()), size(tree.size.data()),
+          value(tree.value.data()), hash(tree.hash.data()), count(tree.nodeCount()) {}
+
+    uint32_t nodeCount() const { return count; }
+    uint32_t nextSibling(uint32_t node) const { return node + size[node]; }
+};
+
+// hash stored for flat_none placeholders; real nodes keep the hash create* gave them
+static const uint64_t FLAT_NONE_HASH = 0;
+
+// true for kinds that come from an ast_stmt node
+inline bool isFlatStmt(uint8_t kind) { return kind >= flat_call; }
+
+// true for kinds whose value is a symbol_id
+inline bool isFlatNamed(uint8_t kind) {
+    return kind == flat_func || kind == flat_extern || kind == flat_var || kind == flat_call || kind == flat_decl;
+}
+
+// Builds the flattened form of the tree rooted at root, replacing whatever out held
+void flattenTree(astNode* root, FlatAst& out);
+
+/**
+ * Rebuilds a pointer tree from its flattened form through the create* functions, so it lands in
+ * the active AstArena (if any) and gets its sizes and hashes like a freshly parsed tree.
+ * returns: the root, or NULL for an empty tree.
+ */
+astNode* unflattenTree(const FlatAst& tree);
+
+// true if the sizes and child counts of tree describe a valid pre-order layout
+bool isWellFormed(const FlatAst& tree);
+
+/**
+ * The same for a view, whose arrays are all nodeCount() long by construction. The passes over
+ * flat trees only stay inside those arrays for trees that pass this check.
+ */
+bool isWellFormed(const FlatAstView& tree);
+
+/**
+ * The same score compareTrees gives the two pointer trees the flat trees were built from,
+ * computed over the flat arrays.
+ */
+int compareFlatTrees(const FlatAstView& tree1, const FlatAstView& tree2);
+
+// The flat counterpart of compareTreesBounded
+int compareFlatTreesBounded(const FlatAstView& tree1, const FlatAstView& tree2, int minScore);
+
+/**
+ * Runs the checks visitNode performs (use before declaration, duplicate declaration in a
+ * scope) over a flat tree. A message for every violation is appended to errors.
+ * returns: true if no violations were found.
+ */
+bool analyzeFlatTree(const FlatAst& tree, std::vector<std::string>& errors);
+
+#endif
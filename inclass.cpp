@@ -1,19 +1,68 @@
 #include "ast.h"
+#include "algorithm"
 #include "cstdlib"
+#include "climits"
 #include "inclass.h"
+#include "logging.h"
+#include "metrics.h"
 #include "semantic_analysis.h"
+#include "sequence_align.h"
 
-// BEGIN DEDUCTOR DEFINITIONS // 
-const int NULL_NODE_DEDUCTOR = 2;
-const int TYPE_MISMATCH_DEDUCTOR = 4;
-const int LENGTH_MISMATCH_DEDUCTOR = 2;
-const int PARAM_MISMATCH_DEDUCTOR = 3;
-const int NAME_MISMATCH_DEDUCTOR = 2;
-const int DECL_NAME_MISMATCH_DEDUCTOR = 3;
-// END DEDUCTOR DEFINITIONS // 
+// Pairs of subtrees compare() still has to visit, next pair last. The walk keeps its own stack instead of recursing,
+// so deeply nested submissions cannot overflow the small stacks of pool threads. Like the scratch below it is kept
+// per thread and reused from pair to pair
+static thread_local vector<pair<astNode*, astNode*>> pairStack;
 
-// Helper compare function which will do the meat of the work 
-int compare(astNode *node1, astNode *node2, int score) {
+// Per-thread scratch for compareBlocks
+static thread_local vector<uint64_t> keys1, keys2;
+static thread_local vector<AlignedPair> blockMatches;
+
+// Score below which compare() stops walking, set by compareTreesBounded for the pair this thread is comparing.
+// Deductions only ever lower the score, so once it is below the cutoff the final score is too
+static thread_local int scoreCutoff = INT_MIN;
+
+// Compares two statement lists along their alignment. Statements whose subtrees hash the same (under the current
+// hash options, so with -H none renamed statements line up too) are lined up first;
+// the statements left between two such anchors are paired by position, and every statement without a partner is
+// charged as a length mismatch. The pairs are pushed for compare() to visit in statement order
+static int compareBlocks(vector<astNode*> *list1, vector<astNode*> *list2, int score) {
+    uint32_t n = list1->size(), m = list2->size();
+    keys1.clear();
+    keys2.clear();
+    for (astNode *stmt : *list1) {
+        keys1.push_back(stmt->hash);
+    }
+    for (astNode *stmt : *list2) {
+        keys2.push_back(stmt->hash);
+    }
+    blockMatches.clear();
+    alignSequences(keys1.data(), n, keys2.data(), m, blockMatches);
+    size_t anchors = blockMatches.size();
+
+    size_t first = pairStack.size();
+    uint32_t next1 = 0, next2 = 0;
+    for (size_t a = 0; a <= anchors; a++) {
+        uint32_t end1 = a < anchors ? blockMatches[a].first : n;
+        uint32_t end2 = a < anchors ? blockMatches[a].second : m;
+        uint32_t gap1 = end1 - next1, gap2 = end2 - next2;
+        for (uint32_t i = 0; i < min(gap1, gap2); i++) {
+            pairStack.emplace_back(list1->at(next1 + i), list2->at(next2 + i));
+        }
+        score -= LENGTH_MISMATCH_DEDUCTOR * abs((int) gap1 - (int) gap2);
+        if (a < anchors) {
+            pairStack.emplace_back(list1->at(end1), list2->at(end2));
+        }
+        next1 = end1 + 1;
+        next2 = end2 + 1;
+    }
+    // the stack pops from the back, so the first statement pair goes last
+    reverse(pairStack.begin() + first, pairStack.end());
+    return score;
+}
+
+// Scores one pair of nodes: applies the deductions for the pair itself and pushes the pairs of children that
+// still have to be compared, last child first
+static int comparePair(astNode *node1, astNode *node2, int score) {
     // Base case 
     // return existing score as it is if both are null
     if (node1 == NULL and node2 == NULL) {
@@ -27,44 +76,33 @@ int compare(astNode *node1, astNode *node2, int score) {
     if (node1->type != node2->type) {
         return score - TYPE_MISMATCH_DEDUCTOR;
     }
+    // identical subtrees add no deductions, so skip the walk when the hashes say they match. Only
+    // valid while names are hashed, since differing names are themselves a deduction
+    if ((getAstHashOptions() & hash_names) and node1->hash == node2->hash and node1->size == node2->size) {
+        return score;
+    }
+    // if they are both program nodes, the externs are the same in every program so only compare the functions
+    if (node1->type == ast_prog and node2->type == ast_prog) {
+        pairStack.emplace_back(node1->prog.func, node2->prog.func);
+        return score;
+    }
     // if they are both functions
     if (node1->type == ast_func and node2->type == ast_func) {
         // Compare params if they dont match up then decrement score by 3
-        if (node1->func.param != node2->func.param) {
+        astNode *param1 = node1->func.param, *param2 = node2->func.param;
+        if ((param1 == NULL) != (param2 == NULL) or (param1 != NULL and param1->var.name != param2->var.name)) {
             score -= PARAM_MISMATCH_DEDUCTOR;
         }
-        // if both function bodies have block statements
-        if (node1->func.body->type == ast_stmt and node2->func.body->type == ast_stmt and node1->func.body->stmt.type == ast_block and node2->func.body->stmt.type == ast_block) {
-            // if they have different number of statements
-            if (node1->func.body->stmt.block.stmt_list->size() != node2->func.body->stmt.block.stmt_list->size()) {
-                int lengthdif = (node1->func.body->stmt.block.stmt_list->size() - node2->func.body->stmt.block.stmt_list->size());
-                score -= LENGTH_MISMATCH_DEDUCTOR * abs(lengthdif);
-            }
-            // compare each statement in the block while it is within the bounds of the shortest list
-            for (int i = 0; i < min(node1->func.body->stmt.block.stmt_list->size(), node2->func.body->stmt.block.stmt_list->size()); i++) {
-                score = compare(node1->func.body->stmt.block.stmt_list->at(i), node2->func.body->stmt.block.stmt_list->at(i), score);
-                return score;
-            }
-        } else {
-            score = compare(node1->func.body, node2->func.body, score);
-            return score;
-        }
+        // function bodies are compared like any other statement, blocks included
+        pairStack.emplace_back(node1->func.body, node2->func.body);
+        return score;
     }
     // if they are both block statements
     if (node1->type == ast_stmt and node2->type == ast_stmt and node1->stmt.type == ast_block and node2->stmt.type == ast_block) {
-        // if they have different number of statements
-        if (node1->stmt.block.stmt_list->size() != node2->stmt.block.stmt_list->size()) {
-            int lengthdif = (node1->stmt.block.stmt_list->size() - node2->stmt.block.stmt_list->size());
-            score -= LENGTH_MISMATCH_DEDUCTOR * abs(lengthdif);
-        }
-        // compare each statement in the block while it is within the bounds of the shortest list
-        for (int i = 0; i < min(node1->stmt.block.stmt_list->size(), node2->stmt.block.stmt_list->size()); i++) {
-            score = compare(node1->stmt.block.stmt_list->at(i), node2->stmt.block.stmt_list->at(i), score);
-            return score;
-        }
+        return compareBlocks(node1->stmt.block.stmt_list, node2->stmt.block.stmt_list, score);
     }
 
-    // if they are both declaration statements
+    // if they are both declaration statements (names are interned, so equal names have equal ids)
     if (node1->type == ast_stmt and node2->type == ast_stmt and node1->stmt.type == ast_decl and node2->stmt.type == ast_decl) {
         if (node1->stmt.decl.name != node2->stmt.decl.name) {
             score -= DECL_NAME_MISMATCH_DEDUCTOR;
@@ -80,53 +118,73 @@ int compare(astNode *node1, astNode *node2, int score) {
         }
     }
 
-    // if they are both extern nodes, ignore them
-    if (node1->type == ast_extern and node2->type == ast_extern) {
+    // if they are both extern nodes or both constants, ignore them; differing values are not a deduction
+    if ((node1->type == ast_extern and node2->type == ast_extern) or (node1->type == ast_cnst and node2->type == ast_cnst)) {
         return score;
     }
 
     // if none of the above cases have been met, then we compare the children of the current node
     if (node1->type == ast_stmt and node2->type == ast_stmt) {
-        if (node1->type == ast_call and node2->type == ast_call) {
-            score = compare(node1->stmt.call.param, node2->stmt.call.param, score);
-        } else if (node1->type == ast_ret and node2->type == ast_ret) {
-            score = compare(node1->stmt.ret.expr, node2->stmt.ret.expr, score);
-        } else if (node1->type == ast_while and node2->type == ast_while) {
-            score = compare(node1->stmt.whilen.cond, node2->stmt.whilen.cond, score);
-            score = compare(node1->stmt.whilen.body, node2->stmt.whilen.body, score);
-        } else if (node1->type == ast_if and node2->type == ast_if) {
-            score = compare(node1->stmt.ifn.cond, node2->stmt.ifn.cond, score);
-            score = compare(node1->stmt.ifn.if_body, node2->stmt.ifn.if_body, score);
-            if (node1->stmt.ifn.else_body != NULL) {
-                score = compare(node1->stmt.ifn.else_body, node2->stmt.ifn.else_body, score);
-            }
-        } else if (node1->type == ast_asgn and node2->type == ast_asgn) {
-            score = compare(node1->stmt.asgn.rhs, node2->stmt.asgn.rhs, score);
-            score = compare(node1->stmt.asgn.lhs, node2->stmt.asgn.lhs, score);
+        if (node1->stmt.type == ast_call and node2->stmt.type == ast_call) {
+            pairStack.emplace_back(node1->stmt.call.param, node2->stmt.call.param);
+        } else if (node1->stmt.type == ast_ret and node2->stmt.type == ast_ret) {
+            pairStack.emplace_back(node1->stmt.ret.expr, node2->stmt.ret.expr);
+        } else if (node1->stmt.type == ast_while and node2->stmt.type == ast_while) {
+            pairStack.emplace_back(node1->stmt.whilen.body, node2->stmt.whilen.body);
+            pairStack.emplace_back(node1->stmt.whilen.cond, node2->stmt.whilen.cond);
+        } else if (node1->stmt.type == ast_if and node2->stmt.type == ast_if) {
+            // compare handles a missing else on either side, which keeps the score symmetric
+            pairStack.emplace_back(node1->stmt.ifn.else_body, node2->stmt.ifn.else_body);
+            pairStack.emplace_back(node1->stmt.ifn.if_body, node2->stmt.ifn.if_body);
+            pairStack.emplace_back(node1->stmt.ifn.cond, node2->stmt.ifn.cond);
+        } else if (node1->stmt.type == ast_asgn and node2->stmt.type == ast_asgn) {
+            pairStack.emplace_back(node1->stmt.asgn.lhs, node2->stmt.asgn.lhs);
+            pairStack.emplace_back(node1->stmt.asgn.rhs, node2->stmt.asgn.rhs);
         }
         return score;
     }
     
     // if they are both expression nodes
     if (node1->type == ast_rexpr and node2->type == ast_rexpr) {
-        score = compare(node1->rexpr.lhs, node2->rexpr.lhs, score);
-        score = compare(node1->rexpr.rhs, node2->rexpr.rhs, score);
+        pairStack.emplace_back(node1->rexpr.rhs, node2->rexpr.rhs);
+        pairStack.emplace_back(node1->rexpr.lhs, node2->rexpr.lhs);
         return score;
     }
     if (node1->type == ast_bexpr and node2->type == ast_bexpr) {
-        score = compare(node1->bexpr.lhs, node2->bexpr.lhs, score);
-        score = compare(node1->bexpr.rhs, node2->bexpr.rhs, score);
+        pairStack.emplace_back(node1->bexpr.rhs, node2->bexpr.rhs);
+        pairStack.emplace_back(node1->bexpr.lhs, node2->bexpr.lhs);
         return score;
     }
     if (node1->type == ast_uexpr and node2->type == ast_uexpr) {
-        score = compare(node1->uexpr.expr, node2->uexpr.expr, score);
+        pairStack.emplace_back(node1->uexpr.expr, node2->uexpr.expr);
         return score;
     }
 
-    printf("Error: No matching case found\n");
+    LOG_DEBUG("compare: no case for node type %d", node1->type);
     return score;
 
 }
+
+// Helper compare function which will do the meat of the work 
+int compare(astNode *node1, astNode *node2, int score) {
+    size_t base = pairStack.size();
+    uint64_t visited = 0;
+    pairStack.emplace_back(node1, node2);
+    while (pairStack.size() > base) {
+        // a bounded comparison has already lost, the rest of the walk cannot matter
+        if (score < scoreCutoff) {
+            pairStack.resize(base);
+            METRIC_COUNT(counter_early_exits, 1);
+            break;
+        }
+        pair<astNode*, astNode*> next = pairStack.back();
+        pairStack.pop_back();
+        score = comparePair(next.first, next.second, score);
+        visited++;
+    }
+    METRIC_COUNT(counter_nodes_compared, visited);
+    return score;
+}
             
 
 // Main entry point function which we will use to compare two given bits of code as per the spec,
@@ -134,4 +192,42 @@ int compare(astNode *node1, astNode *node2, int score) {
 int compareTrees(astNode *rootnode1, astNode *rootnode2) {
     int score = 100;
     return compare(rootnode1, rootnode2, score);
-}
\ No newline at end of file
+}
+
+// Cheap upper bound on compareTrees from the top of the two trees alone: a differing parameter and the difference
+// in length of the function bodies are charged whatever the statements look like. Subtree sizes give no bound,
+// since a type mismatch costs the same for a leaf as for a whole loop
+static int scoreUpperBound(astNode *rootnode1, astNode *rootnode2) {
+    int bound = 100;
+    if (rootnode1 == NULL or rootnode2 == NULL or rootnode1->type != ast_prog or rootnode2->type != ast_prog) {
+        return bound;
+    }
+    astNode *func1 = rootnode1->prog.func, *func2 = rootnode2->prog.func;
+    if (func1 == NULL or func2 == NULL or func1->type != ast_func or func2->type != ast_func) {
+        return bound;
+    }
+    astNode *param1 = func1->func.param, *param2 = func2->func.param;
+    if ((param1 == NULL) != (param2 == NULL) or (param1 != NULL and param1->var.name != param2->var.name)) {
+        bound -= PARAM_MISMATCH_DEDUCTOR;
+    }
+    astNode *body1 = func1->func.body, *body2 = func2->func.body;
+    if (body1 != NULL and body2 != NULL and body1->type == ast_stmt and body2->type == ast_stmt and
+        body1->stmt.type == ast_block and body2->stmt.type == ast_block) {
+        // every statement left over after the alignment is charged, and at least the difference is left over
+        int n = body1->stmt.block.stmt_list->size(), m = body2->stmt.block.stmt_list->size();
+        bound -= LENGTH_MISMATCH_DEDUCTOR * abs(n - m);
+    }
+    return bound;
+}
+
+int compareTreesBounded(astNode *rootnode1, astNode *rootnode2, int minScore) {
+    int bound = scoreUpperBound(rootnode1, rootnode2);
+    if (bound < minScore) {
+        METRIC_COUNT(counter_early_exits, 1);
+        return bound;
+    }
+    scoreCutoff = minScore;
+    int score = compare(rootnode1, rootnode2, 100);
+    scoreCutoff = INT_MIN;
+    return score;
+}
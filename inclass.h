@@ -5,10 +5,20 @@
 #include "ast.h"
 #include <cstdio>
 
-
+// BEGIN DEDUCTOR DEFINITIONS // 
+const int NULL_NODE_DEDUCTOR = 2;
+const int TYPE_MISMATCH_DEDUCTOR = 4;
+const int LENGTH_MISMATCH_DEDUCTOR = 2;
+const int PARAM_MISMATCH_DEDUCTOR = 3;
+const int NAME_MISMATCH_DEDUCTOR = 2;
+const int DECL_NAME_MISMATCH_DEDUCTOR = 3;
+// END DEDUCTOR DEFINITIONS // 
 
 // Function declarations
 int compareTrees(astNode *rootnode1, astNode *rootnode2);
+// Same score as compareTrees when it is at least minScore; otherwise gives up early and returns some
+// score below minScore that is still an upper bound on the real one
+int compareTreesBounded(astNode *rootnode1, astNode *rootnode2, int minScore);
 int compare(astNode *node1, astNode *node2, int score);
 
 #endif // INCLASS_H
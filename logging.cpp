@@ -0,0 +1,113 @@
+/*
+*   MiniC Compiler - Logging
+*
+*   Purpose: The parser and the semantic checks used to printf progress messages and whole trees for every reduction,
+*   which in a batch run cost more than the parsing itself and interleaved freely between threads. This file gives
+*   them a leveled log on stderr that is silent below warnings by default, and a separate JSON lines channel that
+*   tools can read the errors of every submission from.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <mutex>
+#include "logging.h"
+
+std::atomic<int> currentLogLevel(log_warn);
+
+static const char* const LEVEL_NAMES[] = {"error", "warn", "info", "debug", "trace"};
+static const char* const KIND_NAMES[] = {"io", "syntax", "redeclared", "undeclared"};
+
+static std::mutex diagnosticsLock;
+static FILE* diagnosticsFile = NULL;
+static std::atomic<bool> diagnosticsOpen(false); // lets reportDiagnostic skip the formatting without the lock
+
+void setLogLevel(log_level level) {
+    currentLogLevel.store(level, std::memory_order_relaxed);
+}
+
+void logMessage(log_level level, const char* format, ...) {
+    // the whole line is built first and written with one call, which stdio keeps in one piece
+    char line[1024];
+    int len = snprintf(line, sizeof(line), "[%s] ", LEVEL_NAMES[level]);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line + len, sizeof(line) - len - 1, format, args);
+    va_end(args);
+    fprintf(stderr, "%s\n", line);
+}
+
+bool openDiagnostics(const char* path) {
+    std::lock_guard<std::mutex> lock(diagnosticsLock);
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "File open error: %s\n", path);
+        return false;
+    }
+    if (diagnosticsFile != NULL) {
+        fclose(diagnosticsFile);
+    }
+    diagnosticsFile = file;
+    diagnosticsOpen = true;
+    return true;
+}
+
+void closeDiagnostics() {
+    std::lock_guard<std::mutex> lock(diagnosticsLock);
+    if (diagnosticsFile != NULL) {
+        fclose(diagnosticsFile);
+        diagnosticsFile = NULL;
+        diagnosticsOpen = false;
+    }
+}
+
+// appends text to out as the body of a JSON string
+static void appendJsonString(std::string& out, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+        switch (*c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if ((unsigned char) *c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) *c);
+                    out += escaped;
+                } else {
+                    out += *c;
+                }
+        }
+    }
+}
+
+void reportDiagnostic(const char* file, const Diagnostic& diagnostic) {
+    if (!diagnosticsOpen) {
+        return;
+    }
+    std::string record = "{\"file\":\"";
+    appendJsonString(record, file);
+    record += "\",\"line\":" + std::to_string(diagnostic.line) + ",\"kind\":\"" + KIND_NAMES[diagnostic.kind] +
+              "\",\"message\":\"";
+    appendJsonString(record, diagnostic.message.c_str());
+    record += "\"}\n";
+
+    std::lock_guard<std::mutex> lock(diagnosticsLock);
+    if (diagnosticsFile != NULL) {
+        fwrite(record.data(), 1, record.size(), diagnosticsFile);
+    }
+}
+
+std::string formatDiagnostic(const Diagnostic& diagnostic) {
+    if (diagnostic.line <= 0) {
+        return diagnostic.message;
+    }
+    return "line " + std::to_string(diagnostic.line) + ": " + diagnostic.message;
+}
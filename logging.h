@@ -0,0 +1,89 @@
+/*
+* h file for logging.cpp
+*
+* Two output channels besides the results themselves:
+*
+* The log is for people. Messages have a level and go to stderr, one whole line
+* per call, so threads never interleave within a line. Messages more verbose
+* than MINIC_LOG_MAX_LEVEL are removed at compile time together with their
+* arguments; the rest are filtered against the runtime level (log_warn unless
+* raised with -v), so the default build does no I/O for anything below a warning.
+* Build with -DMINIC_LOG_MAX_LEVEL=4 to keep the debug and trace messages.
+*
+* The diagnostics channel is for tools. When it is open, every error found in
+* a submission is also written to it as one JSON object per line.
+*/
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <atomic>
+#include <string>
+
+typedef enum {
+    log_error,
+    log_warn,
+    log_info,
+    log_debug,
+    log_trace
+} log_level;
+
+// most verbose level compiled in, as a number (0 error ... 4 trace)
+#ifndef MINIC_LOG_MAX_LEVEL
+#define MINIC_LOG_MAX_LEVEL 2
+#endif
+
+extern std::atomic<int> currentLogLevel;
+
+// Sets the most verbose level written at runtime; levels above MINIC_LOG_MAX_LEVEL stay out regardless
+void setLogLevel(log_level level);
+
+// Whether a message at level would be written. Constant false for levels compiled out
+inline bool logEnabled(log_level level) {
+    return level <= MINIC_LOG_MAX_LEVEL && level <= currentLogLevel.load(std::memory_order_relaxed);
+}
+
+// Writes one message at level to stderr; use the LOG_* macros, which skip the call when the level is off
+void logMessage(log_level level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+#define LOG_AT(level, ...) do { if (logEnabled(level)) { logMessage(level, __VA_ARGS__); } } while (0)
+#define LOG_ERROR(...) LOG_AT(log_error, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(log_warn, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(log_info, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(log_debug, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(log_trace, __VA_ARGS__)
+
+typedef enum {
+    diag_io,           // the file could not be read
+    diag_syntax,       // the parse failed
+    diag_redeclared,   // a variable declared twice in one scope
+    diag_undeclared    // a variable used before its declaration
+} diag_kind;
+
+// One error found in a submission
+struct Diagnostic {
+    diag_kind kind;
+    int line;            // 0 when the error has no line
+    std::string message;
+};
+
+/**
+ * Opens the diagnostics channel, truncating path.
+ * returns: false, with a message on stderr, if path cannot be written.
+ */
+bool openDiagnostics(const char* path);
+
+// Flushes and closes the diagnostics channel, if it is open
+void closeDiagnostics();
+
+/**
+ * Writes diagnostic to the channel as a line like
+ * {"file":"a.c","line":3,"kind":"undeclared","message":"..."}. Does nothing while the channel is
+ * closed. Safe to call from several threads at once.
+ */
+void reportDiagnostic(const char* file, const Diagnostic& diagnostic);
+
+// "line N: message", or just the message when it has no line
+std::string formatDiagnostic(const Diagnostic& diagnostic);
+
+#endif
@@ -1,97 +1,495 @@
 #include "inclass.h"
 #include "semantic_analysis.h"
 #include "ast.h"
+#include "batch.h"
+#include "corpus.h"
+#include "logging.h"
+#include "metrics.h"
+#include "minhash.h"
+#include "parser.h"
+#include "score_store.h"
+#include "tree_edit.h"
+#include <cerrno>
+#include <climits>
 #include <cstdio>
-#include <stack>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <vector>
+#include <unistd.h>
 
-extern FILE *yyin;             // Declare yyin as an external variable
-extern int yyparse();          // Declare yyparse as an external function
-extern void yylex_destroy();   // Declare yylex_destroy as an external function
-extern astNode *rootNode;      // Declare rootNode as an external variable
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-H mode] [-s scorer [-E costs]] [-l scanner] [-D diagnostics] [-R report] [-v] <file1> <file2>\n", prog);
+    fprintf(stderr, "       %s -b <dir|filelist> [-o matrix.csv] [-j threads] [-I readers] [-Q depth] [-F] [-H mode] [-s scorer [-E costs]] [-C cachedir] [-W corpus] [-K pairs] [-T score] [-P overlap | -L length[:bands] [-q file]]\n", prog);
+    fprintf(stderr, "       %s -A storedir -b <dir|filelist> [-o matrix.csv] [-j threads] [-I readers] [-Q depth] [-F] [-H mode] [-s scorer] [-P overlap | -L length[:bands]]\n", prog);
+    fprintf(stderr, "       %s -M corpus [-o matrix.csv] [-j threads] [-H mode] [-s scorer [-E costs]] [-K pairs] [-T score] [-P overlap | -L length[:bands] | -q file]\n", prog);
+    fprintf(stderr, "       -H all|canon|names|consts|none  what the subtree hashes cover (default all). Block statements are\n"
+                    "           lined up on these hashes, so every mode changes the heuristic scores; canon also hashes and\n"
+                    "           scores trees with variables renamed by first use and commutative operands ordered\n");
+    fprintf(stderr, "       -s heuristic|ted  score with compareTrees (default) or the tree edit distance\n");
+    fprintf(stderr, "       -E cost=value,...  edit costs of the ted scorer, each from 0 to %d: remove, insert, type, name,\n"
+                    "           decl, op and const (default the compareTrees deductors, const 0)\n", MAX_EDIT_COST);
+    fprintf(stderr, "       -l mmap|flex  scan files with the mapped scanner (default) or the flex one\n");
+    fprintf(stderr, "       -I readers  threads reading files ahead of the parsers (default 2)\n");
+    fprintf(stderr, "       -Q depth  files that may wait between two loading stages (default twice the threads)\n");
+    fprintf(stderr, "       -C cachedir  keep parsed trees in cachedir and skip parsing unchanged files\n");
+    fprintf(stderr, "       -W corpus  pack the parsed batch, with the LSH band table of -L (default %u:%u), into a corpus file\n"
+                    "           instead of scoring it\n", MINHASH_LENGTH, MINHASH_BANDS);
+    fprintf(stderr, "       -A storedir  add the batch to the scores kept in storedir, scoring only new or changed files\n");
+    fprintf(stderr, "       -M corpus  score a packed corpus in place, without parsing anything\n");
+    fprintf(stderr, "       -K pairs  only report this many of the most similar pairs, ranked\n");
+    fprintf(stderr, "       -T score  only report pairs scoring at least this, as a pair list\n");
+    fprintf(stderr, "       -D file  also write every parse and semantic error to file, one JSON object per line\n");
+    fprintf(stderr, "       -R file  write counters and phase times to file at exit, as JSON or, for *.prom, Prometheus text\n");
+    fprintf(stderr, "       -v  log more on stderr; repeat for debug and trace output (when compiled in)\n");
+    fprintf(stderr, "       -P overlap  only score pairs sharing this fraction (0-1] of their fingerprints\n");
+    fprintf(stderr, "       -L length[:bands]  only score pairs whose MinHash signatures collide in an LSH band\n");
+    fprintf(stderr, "       -q file  check a single file against the batch through the LSH index; against a corpus (-M), only\n"
+                    "           the file is parsed and the band table stored in the corpus is probed\n");
+}
 
-using SymbolTable = std::vector<char *>;
+// Parses the -H argument into hash_option bits, or returns -1
+static int parseHashOptions(const char* arg) {
+    std::string mode(arg);
+    if (mode == "all") {
+        return hash_names | hash_constants;
+    }
+    if (mode == "canon") {
+        return hash_names | hash_constants | hash_canonical;
+    }
+    if (mode == "names") {
+        return hash_names;
+    }
+    if (mode == "consts") {
+        return hash_constants;
+    }
+    if (mode == "none") {
+        return 0;
+    }
+    return -1;
+}
 
-int main(int argc, char* argv[]){
-    astNode *progNode1 = NULL;
-    astNode *progNode2 = NULL;
+// Parses a count argument such as -j's: a whole number from 0 to INT_MAX; returns false otherwise
+static bool parseCount(const char* arg, unsigned& value) {
+    char* end;
+    errno = 0;
+    long parsed = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno != 0 || parsed < 0 || parsed > INT_MAX) {
+        return false;
+    }
+    value = (unsigned) parsed;
+    return true;
+}
+
+// Parses a score argument such as -T's: a whole number that fits an int and is not NO_SCORE; returns false otherwise
+static bool parseScore(const char* arg, int& value) {
+    char* end;
+    errno = 0;
+    long parsed = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno != 0 || parsed <= NO_SCORE || parsed > INT_MAX) {
+        return false;
+    }
+    value = (int) parsed;
+    return true;
+}
+
+// Parses the -E argument, comma separated cost=value pairs such as "remove=3,const=1"; returns false if it is
+// malformed
+static bool parseEditCosts(const char* arg, TreeEditCosts& costs) {
+    std::string list(arg);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string item = list.substr(start, end - start);
+        size_t equals = item.find('=');
+        unsigned value;
+        if (equals == std::string::npos || !parseCount(item.c_str() + equals + 1, value) || value > (unsigned) MAX_EDIT_COST) {
+            return false;
+        }
+        std::string name = item.substr(0, equals);
+        int* cost = name == "remove" ? &costs.remove :
+                    name == "insert" ? &costs.insert :
+                    name == "type" ? &costs.relabelType :
+                    name == "name" ? &costs.relabelName :
+                    name == "decl" ? &costs.relabelDecl :
+                    name == "op" ? &costs.relabelOp :
+                    name == "const" ? &costs.relabelConst : NULL;
+        if (cost == NULL) {
+            return false;
+        }
+        *cost = (int) value;
+        start = end + 1;
+    }
+    return true;
+}
+
+// Parses the -L argument, "length" or "length:bands"; returns false if it is malformed
+static bool parseLshOptions(const char* arg, BatchOptions& options) {
+    unsigned length = 0, bands = MINHASH_BANDS;
+    int fields = sscanf(arg, "%u:%u", &length, &bands);
+    if (fields < 1 || length == 0 || bands == 0 || bands > length || length % bands != 0) {
+        return false;
+    }
+    options.lshLength = length;
+    options.lshBands = bands;
+    return true;
+}
 
-    if (argc >= 2) {
-        yyin = fopen(argv[1], "r");
-        if (yyin == NULL) {
-            fprintf(stderr, "File open error\n");
+// Scores loaded submissions and writes the result to outPath (stdout if NULL): the pairs of the last
+// submission when it is a query, the top pairs when a count is set, the candidate pairs of a pruned
+// run, the pairs reaching a minimum score, or else the full matrix
+static int scoreAndWrite(std::vector<Submission>& subs, bool query, const char* outPath, const BatchOptions& options) {
+    FILE* out = stdout;
+    if (outPath != NULL) {
+        out = fopen(outPath, "w");
+        if (out == NULL) {
+            fprintf(stderr, "File open error: %s\n", outPath);
             return 1;
         }
+    }
+    if (query) {
+        std::vector<ScoredPair> scores = scoreCandidatePairs(subs, findQueryCandidates(subs, subs.size() - 1, options),
+                                                             options);
+        writeScorePairs(out, subs, scores);
+    } else if (options.topPairs > 0) {
+        writeRankedPairs(out, subs, scoreTopPairs(subs, options.topPairs, options));
+    } else if (options.prunes()) {
+        // pruned run: only pairs with enough fingerprints in common are compared, written as a pair list
+        std::vector<ScoredPair> scores = scoreCandidatePairs(subs, findCandidatePairs(subs, options), options);
+        writeScorePairs(out, subs, scores);
+    } else if (options.minScore != NO_SCORE) {
+        writeScorePairs(out, subs, scorePairsAbove(subs, options));
     } else {
-        fprintf(stderr, "Usage: %s <file1> <file2>\n", argv[0]);
+        writeScoreMatrix(out, subs, scoreAllPairs(subs, options));
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
+
+// Batch mode: parse every submission once and write the all-pairs score matrix. With a query
+// file, only that file is checked against the batch; with packPath, the parsed batch is written
+// out as a corpus file instead of being scored
+static int runBatch(const char* source, const char* queryPath, const char* packPath, const char* outPath,
+                    const BatchOptions& options) {
+    std::vector<std::string> paths;
+    if (!collectSubmissionPaths(source, paths)) {
         return 1;
     }
+    if (paths.empty()) {
+        fprintf(stderr, "No submissions found in %s\n", source);
+        return 1;
+    }
+    if (queryPath != NULL) {
+        paths.push_back(queryPath);
+    }
 
-    #ifdef YYDEBUG
-    yydebug = 1;
-    #endif
+    std::vector<Submission> subs = loadSubmissions(paths, options);
+    int status;
+    if (queryPath != NULL && (subs.empty() || subs.back().path != queryPath)) {
+        fprintf(stderr, "Cannot check %s\n", queryPath);
+        status = 1;
+    } else if (packPath != NULL) {
+        status = writeCorpus(packPath, subs, options.lshLength, options.lshBands) ? 0 : 1;
+    } else {
+        status = scoreAndWrite(subs, queryPath != NULL, outPath, options);
+    }
+    freeSubmissions(subs);
+    return status;
+}
 
-    yyparse();
+// Store mode: add the files of source to the score store in storeDir and write the matrix of everything
+// stored so far. Only the rows of new and changed files are scored
+static int runStore(const char* storeDir, const char* source, const char* outPath, const BatchOptions& options) {
+    std::vector<std::string> paths;
+    if (!collectSubmissionPaths(source, paths)) {
+        return 1;
+    }
+    ScoreStore store;
+    if (!addToScoreStore(storeDir, paths, options, store)) {
+        return 1;
+    }
+    FILE* out = stdout;
+    if (outPath != NULL) {
+        out = fopen(outPath, "w");
+        if (out == NULL) {
+            fprintf(stderr, "File open error: %s\n", outPath);
+            return 1;
+        }
+    }
+    bool ok = writeScoreStoreMatrix(out, storeDir, store);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return ok ? 0 : 1;
+}
 
-    if (rootNode == NULL) {
-        fprintf(stderr, "root is null\n");
+// Corpus mode: score the trees of a packed corpus in place, or check a query file against them
+static int runCorpus(const char* corpusPath, const char* queryPath, const char* outPath, BatchOptions options) {
+    CorpusMapping corpus;
+    if (!corpus.open(corpusPath)) {
         return 1;
     }
-    progNode1 = rootNode;
+    if (queryPath == NULL) {
+        std::vector<Submission> subs = loadCorpus(corpus, options);
+        return scoreAndWrite(subs, false, outPath, options);
+    }
 
-    std::stack<SymbolTable> symbolTableStack;
-    if (rootNode != NULL) {
-        if (!visitNode(rootNode, symbolTableStack)) {
-            fprintf(stderr, "didn't visit root node\n");
-            freeNode(rootNode);
+    // the query's signature has to be cut the way the stored band table was
+    if (options.lshLength > 0 && (options.lshLength != corpus.lshLength() || options.lshBands != corpus.lshBands())) {
+        fprintf(stderr, "%s was indexed with -L %u:%u\n", corpusPath, corpus.lshLength(), corpus.lshBands());
+        return 1;
+    }
+    options.lshLength = corpus.lshLength();
+    options.lshBands = corpus.lshBands();
+    std::vector<Submission> subs = loadCorpusQuery(corpus, queryPath, options);
+    if (subs.empty()) {
+        fprintf(stderr, "Cannot check %s\n", queryPath);
+        return 1;
+    }
+    FILE* out = stdout;
+    if (outPath != NULL) {
+        out = fopen(outPath, "w");
+        if (out == NULL) {
+            fprintf(stderr, "File open error: %s\n", outPath);
+            freeSubmissions(subs);
             return 1;
-        } else {
-            freeNode(rootNode);
         }
-    }  
+    }
+    // every tree loaded before the query collides with it
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    uint32_t query = (uint32_t) subs.size() - 1;
+    for (uint32_t i = 0; i < query; i++) {
+        pairs.push_back(std::make_pair(i, query));
+    }
+    writeScorePairs(out, subs, scoreCandidatePairs(subs, pairs, options));
+    if (out != stdout) {
+        fclose(out);
+    }
+    freeSubmissions(subs);
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+    const char* batchSource = NULL;
+    const char* outPath = NULL;
+    const char* queryPath = NULL;
+    const char* packPath = NULL;
+    const char* corpusPath = NULL;
+    const char* storeDir = NULL;
+    int verbosity = log_warn;
+    BatchOptions options;
+    int opt;
+    bool editCostsSet = false;
+    while ((opt = getopt(argc, argv, "b:o:j:I:Q:FH:P:L:q:s:E:C:W:M:A:K:T:D:R:l:v")) != -1) {
+        switch (opt) {
+            case 'b':
+                batchSource = optarg;
+                break;
+            case 'o':
+                outPath = optarg;
+                break;
+            case 'j':
+                if (!parseCount(optarg, options.threads)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'I':
+                if (!parseCount(optarg, options.readers)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'Q': {
+                unsigned depth;
+                if (!parseCount(optarg, depth)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.queueDepth = depth;
+                break;
+            }
+            case 'F':
+                options.flat = true;
+                break;
+            case 'P':
+                options.minOverlap = atof(optarg);
+                if (options.minOverlap <= 0 || options.minOverlap > 1) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'L':
+                if (!parseLshOptions(optarg, options)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 's':
+                if (strcmp(optarg, "heuristic") == 0) {
+                    options.scorer = scorer_heuristic;
+                } else if (strcmp(optarg, "ted") == 0) {
+                    options.scorer = scorer_ted;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'E':
+                if (!parseEditCosts(optarg, options.editCosts)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                editCostsSet = true;
+                break;
+            case 'C':
+                options.cacheDir = optarg;
+                break;
+            case 'W':
+                packPath = optarg;
+                options.packing = true;
+                break;
+            case 'M':
+                corpusPath = optarg;
+                break;
+            case 'K': {
+                unsigned pairs;
+                if (!parseCount(optarg, pairs) || pairs == 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.topPairs = pairs;
+                break;
+            }
+            case 'T':
+                if (!parseScore(optarg, options.minScore)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'A':
+                storeDir = optarg;
+                break;
+            case 'q':
+                queryPath = optarg;
+                break;
+            case 'D':
+                if (!openDiagnostics(optarg)) {
+                    return 1;
+                }
+                atexit(closeDiagnostics);
+                break;
+            case 'l':
+                if (strcmp(optarg, "mmap") == 0) {
+                    setParserScanner(scanner_mapped);
+                } else if (strcmp(optarg, "flex") == 0) {
+                    setParserScanner(scanner_flex);
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'R':
+                reportMetricsAtExit(optarg);
+                break;
+            case 'v':
+                if (verbosity < log_trace) {
+                    verbosity++;
+                }
+                break;
+            case 'H': {
+                int hashOptions = parseHashOptions(optarg);
+                if (hashOptions < 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                setAstHashOptions((unsigned) hashOptions);
+                break;
+            }
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
 
-    fclose(yyin);
-    yylex_destroy();
+    setLogLevel((log_level) verbosity);
 
-    // second file 
-    if (argc == 3) {
-        yyin = fopen(argv[2], "r");
-        if (yyin == NULL) {
-            fprintf(stderr, "File open error\n");
+    #ifdef YYDEBUG
+    yydebug = 1;
+    #endif
+
+    if (corpusPath != NULL) {
+        if (batchSource != NULL || packPath != NULL) {
+            // corpus trees carry corpus-local name numbers, so they are never mixed with parsed ones; a query
+            // is compared with copies of the trees it collides with, named like parsed ones
+            fprintf(stderr, "-M cannot be combined with -b or -W\n");
             return 1;
         }
+        if (queryPath != NULL && (options.topPairs > 0 || options.minOverlap > 0)) {
+            fprintf(stderr, "-K and -P cannot be combined with -q\n");
+            return 1;
+        }
+        options.flat = true;
+        return runCorpus(corpusPath, queryPath, outPath, options);
+    }
 
-        #ifdef YYDEBUG
-        yydebug = 1;
-        #endif
-
-        yyparse();
+    if (storeDir != NULL) {
+        if (batchSource == NULL || queryPath != NULL || packPath != NULL || !options.cacheDir.empty() ||
+            options.topPairs > 0 || options.minScore != NO_SCORE || editCostsSet) {
+            // the store keeps its own tree cache and every score it holds, and only records the scorer
+            fprintf(stderr, "-A needs -b and cannot be combined with -q, -W, -C, -K, -T or -E\n");
+            return 1;
+        }
+        return runStore(storeDir, batchSource, outPath, options);
+    }
 
-        if (rootNode == NULL) {
-            fprintf(stderr, "root is null\n");
+    if (batchSource != NULL) {
+        if (queryPath != NULL && options.topPairs > 0) {
+            fprintf(stderr, "-K cannot be combined with -q\n");
             return 1;
         }
-        progNode2 = rootNode;
+        // a packed corpus carries the band table of its signatures, which are computed while loading
+        if ((queryPath != NULL || packPath != NULL) && options.lshLength == 0) {
+            options.lshLength = MINHASH_LENGTH;
+            options.lshBands = MINHASH_BANDS;
+        }
+        return runBatch(batchSource, queryPath, packPath, outPath, options);
+    }
 
-        symbolTableStack = std::stack<SymbolTable>();
-        if (rootNode != NULL) {
-            if (!visitNode(rootNode, symbolTableStack)) {
-                fprintf(stderr, "didn't visit root node\n");
-                freeNode(rootNode);
-                return 1;
-            } else {
-                freeNode(rootNode);
-            }
-        }  
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
 
-        fclose(yyin);
-        yylex_destroy();
+    astNode *progNode1 = parseSubmission(argv[optind]);
+    if (progNode1 == NULL) {
+        return 1;
+    }
+    astNode *progNode2 = parseSubmission(argv[optind + 1]);
+    if (progNode2 == NULL) {
+        freeNode(progNode1);
+        return 1;
     }
+    LOG_INFO("%s: root hash %016llx", argv[optind], (unsigned long long) progNode1->hash);
+    LOG_INFO("%s: root hash %016llx", argv[optind + 1], (unsigned long long) progNode2->hash);
 
-    int score = compareTrees(progNode1, progNode2);
+    int score;
+    if (options.scorer == scorer_ted) {
+        FlatAst flat1, flat2;
+        flattenTree(progNode1, flat1);
+        flattenTree(progNode2, flat2);
+        score = treeEditScore(flat1, flat2, options.editCosts);
+    } else {
+        score = compareTrees(progNode1, progNode2);
+    }
     printf("Differential score is: %d\n", score);
-    free(progNode1);
-    free(progNode2);
+    freeNode(progNode1);
+    freeNode(progNode2);
 
     return 0;
 }
@@ -0,0 +1,139 @@
+/*
+*   MiniC Compiler - Metrics
+*
+*   Purpose: A slow batch run could be slow in the scanner, in the parser, in the symbol table or in the comparisons,
+*   and nothing told them apart. This file keeps the per-thread counter blocks the METRIC_* macros count into and
+*   sums them into a report, as JSON or in the Prometheus text format, normally once when the process exits.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "metrics.h"
+
+static const char* const COUNTER_NAMES[counter_count] = {
+    "files_parsed", "bytes_read", "tokens", "nodes_created", "symbol_lookups", "scopes_pushed", "pairs_scored",
+    "nodes_compared", "early_exits"};
+static const char* const COUNTER_HELP[counter_count] = {
+    "MiniC files parsed", "Bytes read from source files and cache entries", "Tokens returned by the scanner",
+    "AST nodes created", "Symbol table declarations and lookups", "Scopes pushed on a symbol table",
+    "Submission pairs scored", "Node pairs visited by the comparisons",
+    "Bounded comparisons stopped before the end of the walk"};
+static const char* const PHASE_NAMES[phase_count] = {"lex", "parse", "visit", "read", "load", "compare", "write"};
+
+static const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+static std::string atExitPath;
+
+#if MINIC_METRICS
+
+thread_local ThreadMetrics* threadMetrics = nullptr;
+
+static std::mutex registryLock;
+// never destroyed, so the blocks stay reachable (and countable) while static destructors and atexit handlers run
+static std::vector<ThreadMetrics*>& registry = *new std::vector<ThreadMetrics*>();
+
+ThreadMetrics* registerThreadMetrics() {
+    ThreadMetrics* metrics = new ThreadMetrics();
+    for (size_t i = 0; i < counter_count; i++) {
+        metrics->counters[i] = 0;
+    }
+    for (size_t i = 0; i < phase_count; i++) {
+        metrics->phaseNanos[i] = 0;
+        metrics->phaseCalls[i] = 0;
+    }
+    std::lock_guard<std::mutex> lock(registryLock);
+    registry.push_back(metrics);
+    return metrics;
+}
+
+#endif
+
+MetricsSnapshot collectMetrics() {
+    MetricsSnapshot total;
+    memset(&total, 0, sizeof(total));
+#if MINIC_METRICS
+    std::lock_guard<std::mutex> lock(registryLock);
+    for (ThreadMetrics* metrics : registry) {
+        for (size_t i = 0; i < counter_count; i++) {
+            total.counters[i] += metrics->counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < phase_count; i++) {
+            total.phaseNanos[i] += metrics->phaseNanos[i].load(std::memory_order_relaxed);
+            total.phaseCalls[i] += metrics->phaseCalls[i].load(std::memory_order_relaxed);
+        }
+    }
+#endif
+    return total;
+}
+
+static void writeJson(FILE* out, const MetricsSnapshot& totals, double wallSeconds) {
+    fprintf(out, "{\n  \"enabled\": %s,\n  \"wall_seconds\": %.6f,\n  \"counters\": {\n",
+            MINIC_METRICS ? "true" : "false", wallSeconds);
+    for (size_t i = 0; i < counter_count; i++) {
+        fprintf(out, "    \"%s\": %llu%s\n", COUNTER_NAMES[i], (unsigned long long) totals.counters[i],
+                i + 1 < counter_count ? "," : "");
+    }
+    fprintf(out, "  },\n  \"phases\": {\n");
+    for (size_t i = 0; i < phase_count; i++) {
+        fprintf(out, "    \"%s\": {\"calls\": %llu, \"seconds\": %.6f}%s\n", PHASE_NAMES[i],
+                (unsigned long long) totals.phaseCalls[i], totals.phaseNanos[i] / 1e9, i + 1 < phase_count ? "," : "");
+    }
+    fprintf(out, "  }\n}\n");
+}
+
+static void writePrometheus(FILE* out, const MetricsSnapshot& totals, double wallSeconds) {
+    fprintf(out, "# HELP minic_metrics_enabled Whether the build counts anything (MINIC_METRICS)\n");
+    fprintf(out, "# TYPE minic_metrics_enabled gauge\nminic_metrics_enabled %d\n", MINIC_METRICS ? 1 : 0);
+    fprintf(out, "# HELP minic_wall_seconds Time since the process started\n");
+    fprintf(out, "# TYPE minic_wall_seconds gauge\nminic_wall_seconds %.6f\n", wallSeconds);
+    for (size_t i = 0; i < counter_count; i++) {
+        fprintf(out, "# HELP minic_%s_total %s\n", COUNTER_NAMES[i], COUNTER_HELP[i]);
+        fprintf(out, "# TYPE minic_%s_total counter\nminic_%s_total %llu\n", COUNTER_NAMES[i], COUNTER_NAMES[i],
+                (unsigned long long) totals.counters[i]);
+    }
+    fprintf(out, "# HELP minic_phase_seconds_total Time spent in each phase, summed over threads\n");
+    fprintf(out, "# TYPE minic_phase_seconds_total counter\n");
+    for (size_t i = 0; i < phase_count; i++) {
+        fprintf(out, "minic_phase_seconds_total{phase=\"%s\"} %.6f\n", PHASE_NAMES[i], totals.phaseNanos[i] / 1e9);
+    }
+    fprintf(out, "# HELP minic_phase_calls_total Times each phase was entered\n");
+    fprintf(out, "# TYPE minic_phase_calls_total counter\n");
+    for (size_t i = 0; i < phase_count; i++) {
+        fprintf(out, "minic_phase_calls_total{phase=\"%s\"} %llu\n", PHASE_NAMES[i],
+                (unsigned long long) totals.phaseCalls[i]);
+    }
+}
+
+bool writeMetricsReport(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "File open error: %s\n", path);
+        return false;
+    }
+    MetricsSnapshot totals = collectMetrics();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - processStart).count();
+    size_t len = strlen(path);
+    if (len > 5 && strcmp(path + len - 5, ".prom") == 0) {
+        writePrometheus(out, totals, wallSeconds);
+    } else {
+        writeJson(out, totals, wallSeconds);
+    }
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+static void writeAtExit() {
+    writeMetricsReport(atExitPath.c_str());
+}
+
+void reportMetricsAtExit(const char* path) {
+    if (atExitPath.empty()) {
+        atexit(writeAtExit);
+    }
+    atExitPath = path;
+}
@@ -0,0 +1,141 @@
+/*
+* h file for metrics.cpp
+*
+* Built-in instrumentation: counters for the work done on the hot paths and
+* monotonic timers around each phase. Every thread counts into a block of its
+* own, so counting is a plain add with no sharing between threads; the blocks
+* are summed when the report is written, normally at exit (-R).
+*
+* Build with -DMINIC_METRICS=0 to compile every METRIC_* macro away. The
+* default, 1, keeps the counters and the phase timers; 2 also times every token
+* the scanner returns, which is precise but costs two clock reads per token.
+* Phase times are summed over threads, so a parallel phase can add up to more
+* than the run's wall time, and nested phases (lex inside parse, parse inside
+* load) are each counted in full.
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#ifndef MINIC_METRICS
+#define MINIC_METRICS 1
+#endif
+
+typedef enum {
+    counter_files_parsed,
+    counter_bytes_read,      // source files, cache entries and files hashed for the cache
+    counter_tokens,
+    counter_nodes_created,
+    counter_symbol_lookups,  // declarations and uses checked against the scoped symbol table
+    counter_scopes_pushed,
+    counter_pairs_scored,
+    counter_nodes_compared,  // node pairs visited by compareTrees and compareFlatTrees
+    counter_early_exits,     // bounded comparisons given up on before the end of the walk
+    counter_count
+} metric_counter;
+
+typedef enum {
+    phase_lex,      // only timed with MINIC_METRICS=2
+    phase_parse,    // parseFile, lexing and the semantic checks included
+    phase_visit,    // visitNode
+    phase_read,     // reading one source file, and its cache entry, in the load pipeline
+    phase_load,     // analyzing one loaded submission: flattening, fingerprinting, caching
+    phase_compare,  // scoring one pool task's share of the pairs
+    phase_write,    // writing a matrix or pair list
+    phase_count
+} metric_phase;
+
+// Sums of every thread's counters and timers
+struct MetricsSnapshot {
+    uint64_t counters[counter_count];
+    uint64_t phaseNanos[phase_count];
+    uint64_t phaseCalls[phase_count];
+};
+
+MetricsSnapshot collectMetrics();
+
+/**
+ * Writes the current totals to path, in the Prometheus text format when path ends in ".prom"
+ * and as JSON otherwise.
+ * returns: false, with a message on stderr, if path cannot be written.
+ */
+bool writeMetricsReport(const char* path);
+
+// Makes the process write its report to path when it exits
+void reportMetricsAtExit(const char* path);
+
+#if MINIC_METRICS
+
+struct ThreadMetrics {
+    std::atomic<uint64_t> counters[counter_count];
+    std::atomic<uint64_t> phaseNanos[phase_count];
+    std::atomic<uint64_t> phaseCalls[phase_count];
+};
+
+extern thread_local ThreadMetrics* threadMetrics;
+
+// Creates and registers the calling thread's block. Blocks are never freed, so the counts of threads that have
+// exited still show up in the totals
+ThreadMetrics* registerThreadMetrics();
+
+inline ThreadMetrics& localMetrics() {
+    if (threadMetrics == nullptr) {
+        threadMetrics = registerThreadMetrics();
+    }
+    return *threadMetrics;
+}
+
+// only the owning thread writes a block, so a relaxed load and store is enough and needs no locked instruction
+inline void addMetric(std::atomic<uint64_t>& value, uint64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void countMetric(metric_counter counter, uint64_t n) {
+    addMetric(localMetrics().counters[counter], n);
+}
+
+// Adds the time from its construction to its destruction to a phase
+class PhaseTimer {
+public:
+    explicit PhaseTimer(metric_phase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        ThreadMetrics& metrics = localMetrics();
+        addMetric(metrics.phaseNanos[phase], nanos);
+        addMetric(metrics.phaseCalls[phase], 1);
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    metric_phase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define METRIC_JOIN2(a, b) a##b
+#define METRIC_JOIN(a, b) METRIC_JOIN2(a, b)
+#define METRIC_COUNT(counter, n) countMetric(counter, n)
+// times the rest of the enclosing scope as phase
+#define METRIC_PHASE(phase) PhaseTimer METRIC_JOIN(phaseTimer, __LINE__)(phase)
+
+#else
+
+#define METRIC_COUNT(counter, n) ((void) 0)
+#define METRIC_PHASE(phase) ((void) 0)
+
+#endif
+
+#if MINIC_METRICS > 1
+#define METRIC_LEX_PHASE() METRIC_PHASE(phase_lex)
+#else
+#define METRIC_LEX_PHASE() ((void) 0)
+#endif
+
+#endif
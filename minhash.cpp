@@ -0,0 +1,167 @@
+/*
+*   MiniC Compiler - MinHash Index
+*
+*   Purpose: The fingerprint index still visits every posting list of every submission, and checking one new
+*   submission against a large historical corpus should not depend on the size of that corpus. This file reduces each
+*   fingerprint set to a fixed-length MinHash signature and buckets signature bands, so near-duplicates are found by a
+*   handful of hash lookups.
+*/
+
+#include <algorithm>
+#include "minhash.h"
+
+// splitmix64 finalizer
+static uint64_t mixMinHash(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// the i-th hash function of the family; distinct seeds give independent looking permutations
+static uint64_t seedFor(unsigned i) {
+    return mixMinHash(0x9e3779b97f4a7c15ULL * (i + 1));
+}
+
+std::vector<uint64_t> minHashSignature(const std::vector<uint64_t>& features, unsigned length) {
+    std::vector<uint64_t> signature(length, UINT64_MAX);
+    for (unsigned i = 0; i < length; i++) {
+        uint64_t seed = seedFor(i);
+        uint64_t least = UINT64_MAX;
+        for (uint64_t feature : features) {
+            least = std::min(least, mixMinHash(feature ^ seed));
+        }
+        signature[i] = least;
+    }
+    return signature;
+}
+
+double estimateSimilarity(const std::vector<uint64_t>& signature1, const std::vector<uint64_t>& signature2) {
+    size_t length = std::min(signature1.size(), signature2.size());
+    if (length == 0) {
+        return 0;
+    }
+    size_t agree = 0;
+    for (size_t i = 0; i < length; i++) {
+        agree += signature1[i] == signature2[i];
+    }
+    return (double) agree / length;
+}
+
+// signature positions per band; a band count that does not fit gives one position per band
+static unsigned rowsPerBand(unsigned length, unsigned bands) {
+    if (bands == 0 || bands > length) {
+        bands = length;
+    }
+    return bands > 0 ? length / bands : 1;
+}
+
+// the bucket key of one band of signature, with the band number mixed in
+static uint64_t bandKey(const std::vector<uint64_t>& signature, unsigned band, unsigned rows) {
+    uint64_t key = mixMinHash(band + 1);
+    for (unsigned r = band * rows; r < (band + 1) * rows && r < signature.size(); r++) {
+        key = mixMinHash(key ^ signature[r]);
+    }
+    return key;
+}
+
+LshIndex::LshIndex(unsigned length, unsigned bands) : length(length), count(0) {
+    rows = rowsPerBand(length, bands);
+}
+
+uint32_t LshIndex::add(const std::vector<uint64_t>& signature) {
+    uint32_t id = count++;
+    for (unsigned band = 0; band < length / rows; band++) {
+        std::vector<uint32_t>& bucket = buckets[bandKey(signature, band, rows)];
+        // a signature colliding with itself in two bands (equal keys) is only stored once
+        if (bucket.empty() || bucket.back() != id) {
+            bucket.push_back(id);
+        }
+    }
+    return id;
+}
+
+std::vector<uint32_t> LshIndex::query(const std::vector<uint64_t>& signature) const {
+    std::vector<uint32_t> hits;
+    for (unsigned band = 0; band < length / rows; band++) {
+        auto found = buckets.find(bandKey(signature, band, rows));
+        if (found != buckets.end()) {
+            hits.insert(hits.end(), found->second.begin(), found->second.end());
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    return hits;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> LshIndex::candidatePairs() const {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (const auto& entry : buckets) {
+        const std::vector<uint32_t>& bucket = entry.second;
+        for (size_t a = 0; a < bucket.size(); a++) {
+            for (size_t b = a + 1; b < bucket.size(); b++) {
+                pairs.push_back(std::make_pair(bucket[a], bucket[b]));
+            }
+        }
+    }
+    // a pair colliding in several bands is reported once
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    return pairs;
+}
+
+void LshIndex::pack(std::vector<LshSlot>& slots, std::vector<uint32_t>& ids) const {
+    slots.clear();
+    ids.clear();
+    if (buckets.empty()) {
+        return;
+    }
+    size_t slotCount = 1;
+    while (slotCount < 2 * buckets.size()) {
+        slotCount *= 2;
+    }
+    slots.assign(slotCount, LshSlot{0, 0, 0});
+    for (const auto& entry : buckets) {
+        size_t slot = entry.first & (slotCount - 1);
+        while (slots[slot].count != 0) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = {entry.first, (uint32_t) ids.size(), (uint32_t) entry.second.size()};
+        ids.insert(ids.end(), entry.second.begin(), entry.second.end());
+    }
+}
+
+PackedLshIndex::PackedLshIndex(unsigned length, unsigned bands, const LshSlot* slots, size_t slotCount,
+                               const uint32_t* ids, size_t idCount, uint32_t limit)
+    : length(length), rows(rowsPerBand(length, bands)), slots(slots), slotCount(slotCount), ids(ids),
+      idCount(idCount), limit(limit) {
+}
+
+std::vector<uint32_t> PackedLshIndex::query(const std::vector<uint64_t>& signature) const {
+    std::vector<uint32_t> hits;
+    if (slotCount == 0) {
+        return hits;
+    }
+    for (unsigned band = 0; band < length / rows; band++) {
+        uint64_t key = bandKey(signature, band, rows);
+        // linear probing up to the first empty slot; the table is at most half full, so that is a few probes
+        size_t slot = key & (slotCount - 1);
+        for (size_t probes = 0; probes < slotCount && slots[slot].count != 0; probes++) {
+            const LshSlot& found = slots[slot];
+            if (found.key == key) {
+                for (uint64_t k = found.first; k < (uint64_t) found.first + found.count && k < idCount; k++) {
+                    if (ids[k] < limit) {
+                        hits.push_back(ids[k]);
+                    }
+                }
+                break;
+            }
+            slot = (slot + 1) & (slotCount - 1);
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    return hits;
+}
@@ -0,0 +1,108 @@
+/*
+* h file for minhash.cpp
+*
+* MinHash signatures and a banded locality sensitive hash index over them.
+* A signature holds, for each of L hash functions, the minimum hash over a
+* feature set (here the winnowed k-gram fingerprints), so two signatures agree
+* in a position with probability equal to the Jaccard similarity of their
+* sets. The index cuts signatures into b bands of L / b rows and buckets each
+* band; sets that collide in any band become candidates. Raising b finds less
+* similar pairs (better recall), lowering it returns fewer pairs.
+*/
+
+#ifndef MINHASH_H
+#define MINHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// defaults for the signature length and the number of LSH bands
+const unsigned MINHASH_LENGTH = 128;
+const unsigned MINHASH_BANDS = 32;
+
+/**
+ * Computes the MinHash signature of a feature set.
+ * returns: length minimums; an empty set gives all UINT64_MAX.
+ */
+std::vector<uint64_t> minHashSignature(const std::vector<uint64_t>& features, unsigned length = MINHASH_LENGTH);
+
+// Fraction of positions in which two signatures of the same length agree, an estimate of their Jaccard similarity
+double estimateSimilarity(const std::vector<uint64_t>& signature1, const std::vector<uint64_t>& signature2);
+
+// One bucket of a packed index: the ids stored under a band key are ids[first, first + count)
+struct LshSlot {
+    uint64_t key;
+    uint32_t first;
+    uint32_t count; // 0 for an empty slot
+};
+
+class LshIndex {
+public:
+    /**
+     * @param length is the signature length and must be a multiple of bands.
+     * @param bands is the number of bands each signature is split into.
+     */
+    LshIndex(unsigned length = MINHASH_LENGTH, unsigned bands = MINHASH_BANDS);
+
+    // adds a signature and returns its id; ids count up from 0
+    uint32_t add(const std::vector<uint64_t>& signature);
+
+    size_t size() const { return count; }
+
+    /**
+     * Looks a signature up without adding it. The cost is one bucket probe per band
+     * plus the size of the buckets hit, independent of the number of indexed signatures.
+     * returns: the ids colliding with signature in at least one band, sorted and without duplicates.
+     */
+    std::vector<uint32_t> query(const std::vector<uint64_t>& signature) const;
+
+    // every pair (i, j), i < j, of indexed signatures colliding in at least one band, sorted
+    std::vector<std::pair<uint32_t, uint32_t>> candidatePairs() const;
+
+    /**
+     * Lays the buckets out for storing in a file: slots becomes an open-addressed table of a power of
+     * two slots, at most half full, and ids holds the ids of every bucket back to back. PackedLshIndex
+     * probes the two arrays in place.
+     */
+    void pack(std::vector<LshSlot>& slots, std::vector<uint32_t>& ids) const;
+
+private:
+    unsigned length;
+    unsigned rows; // signature positions per band
+    uint32_t count;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets; // band key -> ids, band number mixed into the key
+};
+
+/**
+ * An LshIndex laid out by LshIndex::pack, read where it lies, e.g. in a mapped corpus (see corpus.h).
+ * Nothing is loaded up front, so a lookup costs the same few probes however many signatures were packed.
+ */
+class PackedLshIndex {
+public:
+    PackedLshIndex() : length(0), rows(1), slots(NULL), slotCount(0), ids(NULL), idCount(0), limit(0) {}
+
+    /**
+     * @param slotCount must be a power of two, or 0 for an empty index.
+     * @param limit is one past the largest id that was packed. The arrays come from a file, so buckets
+     * reaching past idCount and ids from limit on are skipped rather than trusted.
+     */
+    PackedLshIndex(unsigned length, unsigned bands, const LshSlot* slots, size_t slotCount, const uint32_t* ids,
+                   size_t idCount, uint32_t limit);
+
+    // the same as LshIndex::query on the index that was packed
+    std::vector<uint32_t> query(const std::vector<uint64_t>& signature) const;
+
+private:
+    unsigned length;
+    unsigned rows;
+    const LshSlot* slots;
+    size_t slotCount;
+    const uint32_t* ids;
+    size_t idCount;
+    uint32_t limit;
+};
+
+#endif
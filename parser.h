@@ -0,0 +1,48 @@
+/*
+* Entry point to the reentrant MiniC parser defined in yacc.y, with the
+* scanners of scanner.cpp and lex.l
+*
+* The parser keeps no global state: every call gets its own scanner and
+* returns its tree directly, so any number of files can be parsed concurrently.
+*/
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "logging.h"
+
+// Errors collected while parsing one file, in the order they were found
+struct ParseDiagnostics {
+    std::vector<Diagnostic> errors;
+};
+
+typedef enum {
+    scanner_mapped, // the hand-written scanner of scanner.h over an mmap of the file (default)
+    scanner_flex    // the flex scanner generated from lex.l, reading through stdio
+} scanner_type;
+
+// Chooses the scanner parseFile reads tokens with. Both accept the same language
+void setParserScanner(scanner_type scanner);
+scanner_type getParserScanner();
+
+/**
+ * Parses a single MiniC file and runs the semantic checks on it as it goes.
+ * @param path is the file to parse.
+ * @param diag collects every error with its line and kind. Semantic
+ * errors (use before declaration, duplicate declarations) are collected too but still give a tree.
+ * returns: the root of the AST, or NULL if the file could not be opened or parsed.
+ * The caller owns the tree and releases it with freeNode.
+ */
+astNode* parseFile(const char* path, ParseDiagnostics& diag);
+
+/**
+ * Like parseFile, but parses size bytes of source already in memory at data, which must not be NULL.
+ * The bytes are only read, and not needed once the call returns.
+ */
+astNode* parseSource(const char* data, size_t size, ParseDiagnostics& diag);
+
+#endif
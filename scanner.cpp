@@ -0,0 +1,218 @@
+/*
+*   MiniC Compiler - Mapped Scanner
+*
+*   Purpose: The flex scanner reads every file through stdio buffers and matches it with a general DFA, which made
+*   parsing a large batch lexer-bound. The MiniC token set is a handful of keywords and operators, IDs and NUMs, so
+*   this file scans it by hand straight out of an mmap of the file, one table lookup per byte. It accepts exactly
+*   the language of lex.l, down to the characters lex.l passes through to the parser unchanged.
+*/
+
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ast.h"
+#include "scanner.h"
+#include "yacc.tab.h"
+
+MappedSource::MappedSource() : base(NULL), length(0), mapped(false) {
+}
+
+MappedSource::~MappedSource() {
+    close();
+}
+
+void MappedSource::close() {
+    if (mapped) {
+        munmap((void*) base, length);
+    }
+    base = NULL;
+    length = 0;
+    mapped = false;
+}
+
+bool MappedSource::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        base = "";
+        return true;
+    }
+    void* memory = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    // the scanner reads front to back exactly once
+    madvise(memory, st.st_size, MADV_SEQUENTIAL);
+    base = (const char*) memory;
+    length = st.st_size;
+    mapped = true;
+    return true;
+}
+
+// character classes, as bits so that "may continue an identifier" is a single test
+enum {
+    char_blank = 1,   // ' ' and '\t', skipped
+    char_newline = 2, // skipped and counted
+    char_alpha = 4,   // starts an identifier
+    char_digit = 8,   // starts a number
+    char_ident = 16   // continues an identifier: letters, digits and '_'
+};
+
+struct CharTable {
+    uint8_t classes[256];
+
+    CharTable() {
+        memset(classes, 0, sizeof(classes));
+        classes[(unsigned char) ' '] = char_blank;
+        classes[(unsigned char) '\t'] = char_blank;
+        classes[(unsigned char) '\n'] = char_newline;
+        for (int c = 'a'; c <= 'z'; c++) {
+            classes[c] = char_alpha | char_ident;
+            classes[c - 'a' + 'A'] = char_alpha | char_ident;
+        }
+        for (int c = '0'; c <= '9'; c++) {
+            classes[c] = char_digit | char_ident;
+        }
+        classes[(unsigned char) '_'] = char_ident;
+    }
+};
+
+static const CharTable charTable;
+
+// the keyword spelled by the identifier at text, or ID
+static int keywordKind(const char* text, uint32_t length) {
+    switch (length) {
+        case 2:
+            return memcmp(text, "if", 2) == 0 ? IF : ID;
+        case 3:
+            return memcmp(text, "int", 3) == 0 ? INT : ID;
+        case 4:
+            if (memcmp(text, "void", 4) == 0) {
+                return VOID;
+            }
+            if (memcmp(text, "else", 4) == 0) {
+                return ELSE;
+            }
+            return memcmp(text, "read", 4) == 0 ? READ : ID;
+        case 5:
+            if (memcmp(text, "while", 5) == 0) {
+                return WHILE;
+            }
+            return memcmp(text, "print", 5) == 0 ? PRINT : ID;
+        case 6:
+            if (memcmp(text, "extern", 6) == 0) {
+                return EXTERN;
+            }
+            return memcmp(text, "return", 6) == 0 ? RETURN : ID;
+        default:
+            return ID;
+    }
+}
+
+MiniCScanner::MiniCScanner(const char* data, size_t size) : data(data), size(size), pos(0), lineno(1) {
+}
+
+int MiniCScanner::next(MappedToken& token) {
+    const uint8_t* classes = charTable.classes;
+    while (pos < size) {
+        uint8_t cls = classes[(unsigned char) data[pos]];
+        if (cls & char_newline) {
+            lineno++;
+        } else if (!(cls & char_blank)) {
+            break;
+        }
+        pos++;
+    }
+    token.offset = pos;
+    if (pos == size) {
+        token.kind = 0;
+        token.length = 0;
+        return 0;
+    }
+
+    size_t start = pos;
+    unsigned char c = data[pos++];
+    uint8_t cls = classes[c];
+    if (cls & char_alpha) {
+        while (pos < size && (classes[(unsigned char) data[pos]] & char_ident)) {
+            pos++;
+        }
+        token.length = (uint32_t) (pos - start);
+        token.kind = keywordKind(data + start, token.length);
+        return token.kind;
+    }
+    if (cls & char_digit) {
+        while (pos < size && (classes[(unsigned char) data[pos]] & char_digit)) {
+            pos++;
+        }
+        token.length = (uint32_t) (pos - start);
+        token.kind = NUM;
+        return NUM;
+    }
+
+    bool equalsNext = pos < size && data[pos] == '=';
+    switch (c) {
+        case '=':
+            token.kind = equalsNext ? EQ : EQUALS;
+            break;
+        case '>':
+            token.kind = equalsNext ? GTE : GT;
+            break;
+        case '<':
+            token.kind = equalsNext ? LTE : LT;
+            break;
+        case '+':
+            token.kind = PLUS;
+            break;
+        case '-':
+            token.kind = MINUS;
+            break;
+        case '*':
+            token.kind = MULT;
+            break;
+        case '/':
+            token.kind = DIV;
+            break;
+        default:
+            // like lex.l's catch-all rule, any other byte is its own token, as a (signed) char. A NUL or a byte
+            // above 0x7f therefore ends the input, as it does for the flex scanner
+            token.kind = (signed char) c;
+            break;
+    }
+    if (equalsNext && (c == '=' || c == '>' || c == '<')) {
+        pos++;
+    }
+    token.length = (uint32_t) (pos - start);
+    return token.kind;
+}
+
+symbol_id MiniCScanner::symbol(const MappedToken& token) const {
+    return internSymbol(data + token.offset, token.length);
+}
+
+int MiniCScanner::number(const MappedToken& token) const {
+    // atoi is strtol cast to int: the value saturates at LONG_MAX and is then truncated
+    unsigned long value = 0;
+    for (uint32_t i = 0; i < token.length; i++) {
+        unsigned long digit = data[token.offset + i] - '0';
+        if (value > ((unsigned long) LONG_MAX - digit) / 10) {
+            value = LONG_MAX;
+            break;
+        }
+        value = value * 10 + digit;
+    }
+    return (int) (long) value;
+}
@@ -0,0 +1,73 @@
+/*
+* h file for scanner.cpp
+*
+* A hand-written scanner for the MiniC token set that works on a memory
+* mapped file. It recognises exactly what lex.l does, classifying bytes with a
+* lookup table, and hands out tokens as slices of the mapping: nothing is
+* copied, and the only per-token work beyond classification is interning IDs
+* (see symbol.h), which does not copy names already seen.
+*/
+
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "symbol.h"
+
+// A read-only, private mapping of a whole file
+class MappedSource {
+public:
+    MappedSource();
+    ~MappedSource();
+
+    MappedSource(const MappedSource&) = delete;
+    MappedSource& operator=(const MappedSource&) = delete;
+
+    // returns: false if path cannot be opened or mapped. An empty file maps to an empty source
+    bool open(const char* path);
+    void close();
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    const char* base;
+    size_t length;
+    bool mapped; // false for an empty file, which has nothing to unmap
+};
+
+// One token: its Bison token kind (a character code for single character tokens) and where it is in the source
+struct MappedToken {
+    int kind;
+    size_t offset;
+    uint32_t length;
+};
+
+class MiniCScanner {
+public:
+    MiniCScanner(const char* data, size_t size);
+
+    /**
+     * Scans the next token into token.
+     * returns: its kind, or 0 at the end of the input.
+     */
+    int next(MappedToken& token);
+
+    // line of the input the scanner is on, counted from 1 like flex's yylineno
+    int line() const { return lineno; }
+
+    // the interned name of an ID token
+    symbol_id symbol(const MappedToken& token) const;
+
+    // the value of a NUM token, converted like lex.l's atoi
+    int number(const MappedToken& token) const;
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+    int lineno;
+};
+
+#endif
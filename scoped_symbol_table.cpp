@@ -0,0 +1,112 @@
+/*
+*   MiniC Compiler - Scoped Symbol Table
+*
+*   Purpose: Semantic analysis used to keep a stack of vector<char*> tables, scan the top one linearly for every
+*   declaration and copy the whole stack for every variable use, which is quadratic in nesting depth times
+*   declarations. This table keeps a single hash map with shadow chains and a scope undo log instead, so declare and
+*   lookup are O(1) and leaving a scope only touches the names it declared.
+*/
+
+#include "scoped_symbol_table.h"
+#include "metrics.h"
+
+static const size_t INITIAL_SLOTS = 64;
+
+// Fibonacci hashing spreads the dense, sequential symbol ids over the table
+static size_t hashSymbol(symbol_id sym, size_t mask) {
+    return (size_t) ((sym * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+ScopedSymbolTable::ScopedSymbolTable()
+    : slotSym(INITIAL_SLOTS, EMPTY_SLOT), slotBinding(INITIAL_SLOTS, NO_BINDING), usedSlots(0) {
+}
+
+// returns the slot holding sym, or the empty slot where it would go
+size_t ScopedSymbolTable::findSlot(symbol_id sym) const {
+    size_t mask = slotSym.size() - 1;
+    size_t slot = hashSymbol(sym, mask);
+    while (slotSym[slot] != EMPTY_SLOT && slotSym[slot] != sym) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void ScopedSymbolTable::grow() {
+    std::vector<symbol_id> oldSym;
+    std::vector<int32_t> oldBinding;
+    oldSym.swap(slotSym);
+    oldBinding.swap(slotBinding);
+
+    slotSym.assign(oldSym.size() * 2, EMPTY_SLOT);
+    slotBinding.assign(oldSym.size() * 2, NO_BINDING);
+    for (size_t i = 0; i < oldSym.size(); i++) {
+        if (oldSym[i] != EMPTY_SLOT) {
+            size_t slot = findSlot(oldSym[i]);
+            slotSym[slot] = oldSym[i];
+            slotBinding[slot] = oldBinding[i];
+        }
+    }
+}
+
+void ScopedSymbolTable::pushScope() {
+    METRIC_COUNT(counter_scopes_pushed, 1);
+    scopeStart.push_back(bindings.size());
+}
+
+void ScopedSymbolTable::popScope() {
+    if (scopeStart.empty()) {
+        return;
+    }
+    size_t start = scopeStart.back();
+    scopeStart.pop_back();
+    // undo the scope's bindings newest first, uncovering whatever each one shadowed
+    while (bindings.size() > start) {
+        const Binding& binding = bindings.back();
+        slotBinding[findSlot(binding.sym)] = binding.shadowed;
+        bindings.pop_back();
+    }
+}
+
+bool ScopedSymbolTable::declare(symbol_id sym, uint32_t value) {
+    METRIC_COUNT(counter_symbol_lookups, 1);
+    // keep the load factor at or below one half so probe chains stay short
+    if ((usedSlots + 1) * 2 > slotSym.size()) {
+        grow();
+    }
+    size_t slot = findSlot(sym);
+    if (slotSym[slot] == EMPTY_SLOT) {
+        slotSym[slot] = sym;
+        usedSlots++;
+    }
+
+    int32_t current = slotBinding[slot];
+    if (current != NO_BINDING && bindings[current].depth == depth()) {
+        return false;
+    }
+    bindings.push_back({sym, (uint32_t) depth(), current, value});
+    slotBinding[slot] = (int32_t) (bindings.size() - 1);
+    return true;
+}
+
+bool ScopedSymbolTable::isDeclared(symbol_id sym) const {
+    METRIC_COUNT(counter_symbol_lookups, 1);
+    size_t slot = findSlot(sym);
+    return slotSym[slot] != EMPTY_SLOT && slotBinding[slot] != NO_BINDING;
+}
+
+uint32_t* ScopedSymbolTable::lookup(symbol_id sym) {
+    METRIC_COUNT(counter_symbol_lookups, 1);
+    size_t slot = findSlot(sym);
+    if (slotSym[slot] == EMPTY_SLOT || slotBinding[slot] == NO_BINDING) {
+        return NULL;
+    }
+    return &bindings[slotBinding[slot]].value;
+}
+
+void ScopedSymbolTable::clear() {
+    slotSym.assign(slotSym.size(), EMPTY_SLOT);
+    slotBinding.assign(slotBinding.size(), NO_BINDING);
+    usedSlots = 0;
+    bindings.clear();
+    scopeStart.clear();
+}
@@ -0,0 +1,78 @@
+/*
+* h file for scoped_symbol_table.cpp
+*
+* A ScopedSymbolTable answers "is this name declared in the innermost scope"
+* and "is this name visible at all" in O(1), and pops a scope in O(k) for the k
+* names that scope declared. There is one open addressing hash map from symbol
+* to its innermost binding; each binding links to the binding it shadows, and
+* the binding stack doubles as the undo log that popScope() unwinds.
+*/
+
+#ifndef SCOPED_SYMBOL_TABLE_H
+#define SCOPED_SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "symbol.h"
+
+class ScopedSymbolTable {
+public:
+    ScopedSymbolTable();
+
+    void pushScope();
+
+    // Unbinds every name declared since the matching pushScope()
+    void popScope();
+
+    /**
+     * Declares sym in the innermost scope, shadowing any outer declaration.
+     * @param value is kept with the declaration for lookup().
+     * returns: false, without declaring anything, if sym is already declared in the innermost scope.
+     */
+    bool declare(symbol_id sym, uint32_t value = 0);
+
+    // true if sym is declared in any open scope
+    bool isDeclared(symbol_id sym) const;
+
+    /**
+     * The value of the declaration of sym visible from the innermost scope, which the caller may change.
+     * returns: NULL if sym is not declared. The pointer is only good until the next declare().
+     */
+    uint32_t* lookup(symbol_id sym);
+
+    // number of open scopes
+    size_t depth() const { return scopeStart.size(); }
+
+    // number of names declared in the innermost scope
+    size_t scopeSize() const { return scopeStart.empty() ? 0 : bindings.size() - scopeStart.back(); }
+
+    // Pops every scope and forgets every name, keeping the allocated capacity
+    void clear();
+
+private:
+    static constexpr int32_t NO_BINDING = -1;
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    struct Binding {
+        symbol_id sym;
+        uint32_t depth;   // depth() when the binding was made
+        int32_t shadowed; // binding this one hides, or NO_BINDING
+        uint32_t value;
+    };
+
+    size_t findSlot(symbol_id sym) const;
+    void grow();
+
+    // slotSym[i] is the key of slot i (EMPTY_SLOT if unused) and slotBinding[i] its innermost
+    // binding. Keys are never removed: a name whose last binding is popped keeps its slot
+    // with NO_BINDING, so probing never needs tombstones
+    std::vector<symbol_id> slotSym;
+    std::vector<int32_t> slotBinding;
+    size_t usedSlots;
+
+    std::vector<Binding> bindings;     // every live binding, in declaration order
+    std::vector<size_t> scopeStart;    // bindings.size() at each pushScope()
+};
+
+#endif
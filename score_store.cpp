@@ -0,0 +1,411 @@
+/*
+*   MiniC Compiler - Score Store
+*
+*   Purpose: A late submission used to mean rerunning the whole batch, reparsing and rescoring every pair. This file
+*   keeps the scores and the parsed trees of a batch on disk, so new submissions are parsed alone, only their own
+*   rows of the matrix are computed and those rows are appended to the ones already stored.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <unordered_map>
+#include "ast_cache.h"
+#include "metrics.h"
+#include "minhash.h"
+#include "score_store.h"
+#include "thread_pool.h"
+
+static const char STORE_MAGIC[4] = {'M', 'C', 'S', 'S'};
+
+// entries.bin: this header, then the key, live flag, path length and path of each entry
+struct StoreHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t scorer;
+    uint32_t hashOptions;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+// scores.bin: this header, then for each entry r in turn its r + 1 scores against entries 0..r
+struct RowsHeader {
+    char magic[4];
+    uint32_t version;
+};
+
+static std::string entryFile(const std::string& dir) {
+    return dir + "/entries.bin";
+}
+
+static std::string rowsFile(const std::string& dir) {
+    return dir + "/scores.bin";
+}
+
+static std::string treeDir(const std::string& dir) {
+    return dir + "/trees";
+}
+
+// index of the first score of row r among the scores of scores.bin
+static size_t rowStart(size_t row) {
+    return row * (row + 1) / 2;
+}
+
+static off_t rowOffset(size_t row) {
+    return (off_t) sizeof(RowsHeader) + (off_t) (rowStart(row) * sizeof(int));
+}
+
+/*
+ * Checks that scores.bin holds the rows of count entries. A missing file is fine while there are no
+ * entries: an add that failed before its entry list was written leaves rows no entry refers to.
+ */
+static bool checkRows(const std::string& dir, size_t count) {
+    std::string path = rowsFile(dir);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT && count == 0) {
+            return true;
+        }
+        fprintf(stderr, "Cannot read %s\n", path.c_str());
+        return false;
+    }
+    struct stat st;
+    RowsHeader header;
+    bool ok = fstat(fd, &st) == 0 && pread(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header) &&
+              memcmp(header.magic, STORE_MAGIC, 4) == 0;
+    close(fd);
+    if (!ok || st.st_size < rowOffset(count)) {
+        fprintf(stderr, "Corrupt score store %s\n", path.c_str());
+        return false;
+    }
+    if (header.version != SCORE_STORE_VERSION) {
+        fprintf(stderr, "Score store %s was written by another version, rebuild it\n", dir.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool loadScoreStore(const std::string& dir, ScoreStore& store) {
+    store = ScoreStore();
+    std::string path = entryFile(dir);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        return errno == ENOENT && checkRows(dir, 0);
+    }
+
+    StoreHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, STORE_MAGIC, 4) == 0 &&
+              header.version == SCORE_STORE_VERSION;
+    for (uint32_t i = 0; ok && i < header.count; i++) {
+        uint64_t key;
+        uint32_t live, len;
+        ok = fread(&key, sizeof(key), 1, file) == 1 && fread(&live, sizeof(live), 1, file) == 1 &&
+             fread(&len, sizeof(len), 1, file) == 1 && len < 65536;
+        if (ok) {
+            std::string entry(len, '\0');
+            ok = fread(&entry[0], 1, len, file) == len;
+            store.paths.push_back(entry);
+            store.keys.push_back(key);
+            store.live.push_back(live != 0);
+        }
+    }
+    ok = ok && fgetc(file) == EOF;
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "Corrupt score store %s\n", path.c_str());
+        store = ScoreStore();
+        return false;
+    }
+    store.scorer = (scorer_type) header.scorer;
+    store.hashOptions = header.hashOptions;
+    if (!checkRows(dir, store.paths.size())) {
+        store = ScoreStore();
+        return false;
+    }
+    return true;
+}
+
+bool saveScoreStore(const std::string& dir, const ScoreStore& store) {
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s\n", dir.c_str());
+        return false;
+    }
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORE_MAGIC, 4);
+    header.version = SCORE_STORE_VERSION;
+    header.scorer = store.scorer;
+    header.hashOptions = store.hashOptions;
+    header.count = (uint32_t) store.paths.size();
+
+    std::string path = entryFile(dir);
+    std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "File open error: %s\n", temp.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < store.paths.size(); i++) {
+        uint32_t live = store.live[i] ? 1 : 0;
+        uint32_t len = (uint32_t) store.paths[i].size();
+        ok = fwrite(&store.keys[i], sizeof(uint64_t), 1, file) == 1 && fwrite(&live, sizeof(live), 1, file) == 1 &&
+             fwrite(&len, sizeof(len), 1, file) == 1 && fwrite(store.paths[i].data(), 1, len, file) == len;
+    }
+    ok = fclose(file) == 0 && ok;
+    if (ok) {
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Cannot write score store %s\n", path.c_str());
+        unlink(temp.c_str());
+    }
+    return ok;
+}
+
+// Cuts scores.bin back to its first rowCount rows, dropping those of a failed add, and appends rows
+static bool appendRows(const std::string& dir, size_t rowCount, const std::vector<int>& rows) {
+    std::string path = rowsFile(dir);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        fprintf(stderr, "File open error: %s\n", path.c_str());
+        return false;
+    }
+    RowsHeader header;
+    memcpy(header.magic, STORE_MAGIC, 4);
+    header.version = SCORE_STORE_VERSION;
+    size_t bytes = rows.size() * sizeof(int);
+    bool ok = pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header) &&
+              ftruncate(fd, rowOffset(rowCount)) == 0 &&
+              (bytes == 0 || pwrite(fd, rows.data(), bytes, rowOffset(rowCount)) == (ssize_t) bytes);
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Cannot write score store %s\n", path.c_str());
+    }
+    return ok;
+}
+
+// Reads the fingerprints of each stored submission from its cache entry; a missing entry leaves them empty
+static std::vector<bool> loadStoredFingerprints(std::vector<Submission>& subs, const BatchOptions& options) {
+    std::vector<char> found(subs.size(), 0);
+    WorkStealingPool pool(options.threads);
+    for (size_t i = 0; i < subs.size(); i++) {
+        pool.submit([&subs, &found, &options, i](unsigned) {
+            Submission& sub = subs[i];
+            found[i] = loadCachedFingerprints(options.cacheDir, sub.key, sub.fingerprints);
+            if (found[i] && options.lshLength > 0) {
+                sub.signature = minHashSignature(sub.fingerprints, options.lshLength);
+            }
+        });
+    }
+    pool.wait();
+    return std::vector<bool>(found.begin(), found.end());
+}
+
+bool addToScoreStore(const std::string& dir, const std::vector<std::string>& paths, const BatchOptions& options,
+                     ScoreStore& store) {
+    if (!loadScoreStore(dir, store)) {
+        return false;
+    }
+    if (!store.paths.empty() && (store.scorer != options.scorer || store.hashOptions != getAstHashOptions())) {
+        fprintf(stderr, "Score store %s was built with another scorer or other hash options\n", dir.c_str());
+        return false;
+    }
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s\n", dir.c_str());
+        return false;
+    }
+    BatchOptions storeOptions = options;
+    storeOptions.cacheDir = treeDir(dir);
+
+    // sort the incoming files into unchanged ones and ones to (re)score
+    size_t rowCount = store.paths.size();
+    std::unordered_map<std::string, size_t> stored;
+    for (size_t i = 0; i < rowCount; i++) {
+        if (store.live[i]) {
+            stored[store.paths[i]] = i;
+        }
+    }
+    std::vector<std::string> added;
+    std::unordered_map<std::string, bool> seen;
+    for (const std::string& path : paths) {
+        if (seen[path]) {
+            continue;
+        }
+        seen[path] = true;
+        uint64_t key;
+        if (!hashFileContents(path.c_str(), key)) {
+            fprintf(stderr, "Cannot read %s\n", path.c_str());
+            continue;
+        }
+        auto found = stored.find(path);
+        if (found != stored.end()) {
+            if (store.keys[found->second] == key) {
+                continue;
+            }
+            store.live[found->second] = false;
+        }
+        added.push_back(path);
+    }
+    if (added.empty()) {
+        return true;
+    }
+
+    // a pruned add needs only the fingerprints of the stored submissions to find its candidates;
+    // otherwise every stored tree is scored against the new rows
+    std::vector<std::string> keptPaths;
+    std::vector<uint64_t> keptKeys;
+    std::vector<size_t> keptIndex; // entry of each stored submission
+    for (size_t i = 0; i < rowCount; i++) {
+        if (store.live[i]) {
+            keptPaths.push_back(store.paths[i]);
+            keptKeys.push_back(store.keys[i]);
+            keptIndex.push_back(i);
+        }
+    }
+    std::vector<Submission> kept;
+    std::vector<bool> found;
+    if (options.prunes()) {
+        kept.resize(keptPaths.size());
+        for (size_t i = 0; i < kept.size(); i++) {
+            kept[i].path = keptPaths[i];
+            kept[i].key = keptKeys[i];
+        }
+        found = loadStoredFingerprints(kept, storeOptions);
+    } else {
+        kept = loadCachedSubmissions(keptPaths, keptKeys, storeOptions);
+        for (const Submission& sub : kept) {
+            found.push_back(sub.loaded());
+        }
+    }
+
+    std::vector<Submission> subs;
+    std::vector<size_t> entry; // entry of each submission in subs
+    for (size_t i = 0; i < kept.size(); i++) {
+        if (!found[i]) {
+            // the cache entry is gone: score the file again from its source, if it is still there
+            fprintf(stderr, "Cached tree of %s is missing, rescoring it\n", kept[i].path.c_str());
+            store.live[keptIndex[i]] = false;
+            added.push_back(kept[i].path);
+            continue;
+        }
+        entry.push_back(keptIndex[i]);
+        subs.push_back(std::move(kept[i]));
+    }
+    size_t firstNew = subs.size();
+    std::vector<Submission> fresh = loadSubmissions(added, storeOptions);
+    for (Submission& sub : fresh) {
+        entry.push_back(store.paths.size());
+        store.paths.push_back(sub.path);
+        store.keys.push_back(sub.key);
+        store.live.push_back(true);
+        subs.push_back(std::move(sub));
+    }
+    size_t n = subs.size();
+
+    // only the rows of the new submissions are scored
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    if (options.prunes()) {
+        pairs = findNewCandidatePairs(subs, firstNew, options);
+        for (size_t a = firstNew; a < n; a++) {
+            pairs.push_back(std::make_pair((uint32_t) a, (uint32_t) a));
+        }
+
+        // load the trees of just the stored submissions some new row is scored against
+        std::vector<bool> needed(firstNew, false);
+        for (const std::pair<uint32_t, uint32_t>& pair : pairs) {
+            if (pair.first < firstNew) {
+                needed[pair.first] = true;
+            }
+        }
+        std::vector<std::string> neededPaths;
+        std::vector<uint64_t> neededKeys;
+        std::vector<size_t> neededIndex;
+        for (size_t i = 0; i < firstNew; i++) {
+            if (needed[i]) {
+                neededPaths.push_back(subs[i].path);
+                neededKeys.push_back(subs[i].key);
+                neededIndex.push_back(i);
+            }
+        }
+        std::vector<Submission> trees = loadCachedSubmissions(neededPaths, neededKeys, storeOptions);
+        for (size_t i = 0; i < trees.size(); i++) {
+            subs[neededIndex[i]] = std::move(trees[i]);
+        }
+        // an entry removed since its fingerprints were read leaves its pairs unscored
+        pairs.erase(std::remove_if(pairs.begin(), pairs.end(),
+                                   [&subs](const std::pair<uint32_t, uint32_t>& pair) {
+                                       return !subs[pair.first].loaded();
+                                   }),
+                    pairs.end());
+    } else {
+        for (size_t a = firstNew; a < n; a++) {
+            for (size_t j = 0; j <= a; j++) {
+                pairs.push_back(std::make_pair((uint32_t) j, (uint32_t) a));
+            }
+        }
+    }
+
+    std::vector<int> rows(rowStart(store.paths.size()) - rowStart(rowCount), NO_SCORE);
+    for (const ScoredPair& pair : scoreCandidatePairs(subs, pairs, options)) {
+        size_t row = std::max(entry[pair.first], entry[pair.second]);
+        size_t column = std::min(entry[pair.first], entry[pair.second]);
+        rows[rowStart(row) - rowStart(rowCount) + column] = pair.score;
+    }
+    freeSubmissions(subs);
+
+    store.scorer = options.scorer;
+    store.hashOptions = getAstHashOptions();
+    return appendRows(dir, rowCount, rows) && saveScoreStore(dir, store);
+}
+
+bool writeScoreStoreMatrix(FILE* out, const std::string& dir, const ScoreStore& store) {
+    METRIC_PHASE(phase_write);
+    std::vector<size_t> live;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < store.paths.size(); i++) {
+        if (store.live[i]) {
+            live.push_back(i);
+            paths.push_back(store.paths[i]);
+        }
+    }
+    writeScoreMatrixHeader(out, paths);
+    if (live.empty()) {
+        return true;
+    }
+
+    std::string path = rowsFile(dir);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot read %s\n", path.c_str());
+        return false;
+    }
+    size_t length = rowOffset(store.paths.size());
+    struct stat st;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t) length) {
+        mapped = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Cannot read %s\n", path.c_str());
+        return false;
+    }
+
+    const int* scores = (const int*) ((const char*) mapped + sizeof(RowsHeader));
+    std::vector<int> row(live.size());
+    for (size_t i = 0; i < live.size(); i++) {
+        for (size_t j = 0; j < live.size(); j++) {
+            size_t a = std::max(live[i], live[j]), b = std::min(live[i], live[j]);
+            row[j] = scores[rowStart(a) + b];
+        }
+        writeScoreMatrixRow(out, paths[i], row.data(), row.size());
+    }
+    munmap(mapped, length);
+    return true;
+}
@@ -0,0 +1,61 @@
+/*
+* h file for score_store.cpp
+*
+* A score store is a directory holding the list of every submission added so
+* far (entries.bin), their scores (scores.bin) and their cached trees (trees/,
+* see ast_cache.h). scores.bin keeps the lower triangle of the score matrix,
+* one row per entry in the order the entries were added, so adding k files to
+* a store of N appends k rows and never rewrites the N stored ones. Only the
+* k files are parsed, and only the stored trees some new row is scored against
+* are loaded: O(k N) comparisons instead of the O((N + k)^2) of a fresh batch run.
+*/
+
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "batch.h"
+
+// bump whenever the layout of entries.bin or scores.bin changes
+const uint32_t SCORE_STORE_VERSION = 2;
+
+struct ScoreStore {
+    scorer_type scorer = scorer_heuristic; // scores of different scorers or hash options never mix
+    unsigned hashOptions = 0;
+    std::vector<std::string> paths;        // every entry in the order it was added, its row in scores.bin
+    std::vector<uint64_t> keys;            // content hash of each submission, its cache entry name
+    std::vector<bool> live;                // false once an entry is superseded by a later one for the same path
+};
+
+/**
+ * Reads the entry list of the store in dir and checks that scores.bin holds a row for each entry.
+ * A directory without a store gives an empty one.
+ * returns: false, with a message on stderr, if the store is unreadable, corrupt or of another version.
+ */
+bool loadScoreStore(const std::string& dir, ScoreStore& store);
+
+// Writes the entry list of store into dir atomically. The rows of its entries must be in scores.bin already.
+bool saveScoreStore(const std::string& dir, const ScoreStore& store);
+
+/**
+ * Adds the files in paths to the store in dir and saves it. Files already stored with the same
+ * contents are skipped; a stored path whose contents changed is rescored as a new entry and its old
+ * entry is retired. New rows are scored against every live entry, or, when options prune, only against
+ * their candidates (the other entries of those rows are NO_SCORE). The rows are appended to scores.bin
+ * before the entry list is replaced, so an add that fails halfway leaves the previous store intact.
+ * returns: false, with a message on stderr, if the store could not be read or written, or was
+ * built with another scorer or other hash options.
+ */
+bool addToScoreStore(const std::string& dir, const std::vector<std::string>& paths, const BatchOptions& options,
+                     ScoreStore& store);
+
+/**
+ * Writes the score matrix of the live entries of store, in store order, in the format of writeScoreMatrix.
+ * The rows are read from the mapped scores.bin, so the matrix is never held in memory.
+ * returns: false, with a message on stderr, if scores.bin could not be read.
+ */
+bool writeScoreStoreMatrix(FILE* out, const std::string& dir, const ScoreStore& store);
+
+#endif
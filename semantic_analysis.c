@@ -2,7 +2,7 @@
 *   MiniC Compiler - Semantic Analysis
 *
 *   Purpose: This file is the implementation of the Semantic Analysis for the MiniC compiler. It runs through the AST and
-*   to perform semantic checks and constuct a stack of symbol tables. The purpose of the semantic checks is to ensure proper scope
+*   to perform semantic checks and constuct a scoped symbol table. The purpose of the semantic checks is to ensure proper scope
 *   and declaration of variables. In other words, it ensures that the input file abides by two rules: a variable is declared before it is used
 *   and there is only one declaration of the variable in a scope. 
 *
@@ -11,122 +11,108 @@
 */
 
 #include <stdio.h>
-#include <vector>
-#include <stack>
 #include "ast.h"
 #include "semantic_analysis.h"
-#include <algorithm>
-#include <string>
-#include <cstring>
+#include "scoped_symbol_table.h"
+#include "logging.h"
+#include "metrics.h"
 
-using SymbolTable = vector<char *>;  // symbol table data structure 
+// One entry of the explicit stack visitNode walks the tree with. Besides the nodes still to visit it holds the
+// points where a scope has to be popped and the null statements to report once the walk reaches them
+typedef enum {
+    visit_node,
+    visit_pop_scope,
+    visit_null_func_stmt,
+    visit_null_block_stmt
+} visit_action;
 
-bool visitNode(astNode* node, stack<SymbolTable>& symbolTableStack);
+typedef struct {
+    visit_action action;
+    astNode* node;
+    bool root; // errors only make visitNode fail when they come from the node it was called on
+} visitItem;
 
-bool visitNode(astNode* node, stack<SymbolTable>& symbolTableStack){
+static thread_local vector<visitItem> visitStack;
+
+static void pushVisit(visit_action action, astNode* node, bool root = false) {
+    visitStack.push_back({action, node, root});
+}
+
+// pushes the statements of a list so that they are visited first to last; a null statement is reported when its
+// turn comes, as a func or block statement
+static void pushStatements(vector<astNode*>* list, visit_action nullAction, bool root) {
+    for (size_t i = list->size(); i > 0; i--) {
+        astNode* stmt = list->at(i - 1);
+        if (stmt == nullptr) {
+            pushVisit(nullAction, nullptr, root);
+        } else {
+            pushVisit(visit_node, stmt);
+        }
+    }
+}
+
+// visits one node: runs its checks and pushes what has to be visited after it, last first.
+// returns: false if a check on the node itself failed
+static bool visitOne(astNode* node, ScopedSymbolTable& symbols, bool root) {
     //checking if node passed is a null pointer
     if(node == nullptr){
-        fprintf(stderr, "Error: node is null.\n");
+        LOG_ERROR("node is null");
         return false;
     }
-    // if the node is a block statement node and is body of a function: 
-    // get the top symbol table from the stack and use it as the curr_sym_table 
-    // visit all nodes in the statement list of block statement 
-    // pop top of the stack
+    // if the node is a function: 
+    // open one scope for the parameter and the declarations of the body block 
+    // visit all nodes in the statement list of the body 
+    // pop the scope once they have all been visited
     if (node->type == ast_func) {
             astNode* blockNode = node->func.body;
-            SymbolTable curr_sym_table;
+            symbols.pushScope();
             if (node->func.param != nullptr) {
-                curr_sym_table.push_back(node->func.param->var.name);
-                printf("Size of : %ld\n", curr_sym_table.size());
+                symbols.declare(node->func.param->var.name);
+                LOG_DEBUG("scope size: %zu", symbols.scopeSize());
             }
-            symbolTableStack.push(curr_sym_table);
+            pushVisit(visit_pop_scope, nullptr);
             if (blockNode->stmt.block.stmt_list != nullptr) {
-                for (astNode* stmt : *(blockNode->stmt.block.stmt_list)) {
-                    // handling possible errors where the stmt is a null pointer
-                    if (stmt == nullptr) {
-                        fprintf(stderr, "Statement node is null\n");
-                        continue;
-                    }
-                    visitNode(stmt, symbolTableStack);
-                }
+                pushStatements(blockNode->stmt.block.stmt_list, visit_null_func_stmt, root);
             }
-            symbolTableStack.pop();
+            return true;
     }
 
 
     // if the node is a block statement node: 
-    // create a new symbol table curr_sym_table and push it to the symbol table stack
+    // push a new scope 
     // visit all nodes in the statement list of block statement 
-    // pop top of the stack
+    // pop the scope, which unbinds everything it declared
     if (node->type == ast_stmt && node->stmt.type == ast_block){
-        SymbolTable curr_sym_table;
-        symbolTableStack.push(curr_sym_table);
+        symbols.pushScope();
+        pushVisit(visit_pop_scope, nullptr);
         if(node->stmt.block.stmt_list != NULL){
-            for (astNode* stmt : *(node->stmt.block.stmt_list)) {
-                // handling possible errors where the stmt is a null pointer
-                if(stmt == nullptr){
-                    fprintf(stderr, "Statement node is null.\n");
-                    return false;
-                }
-                visitNode(stmt, symbolTableStack);
-            }
+            pushStatements(node->stmt.block.stmt_list, visit_null_block_stmt, root);
         }
-        symbolTableStack.pop();
+        return true;
     }
 
 
 
-    // if the node is a declaration statement, check if the variable is in the symbol table 
-    // at the top of the stack. If it does, then emit an error message. 
-    // Otherwise, add the variable to the symbol table at the top of the stack.
+    // if the node is a declaration statement, check if the variable is already declared in the 
+    // innermost scope. If it is, then emit an error message. 
+    // Otherwise, declare the variable in the innermost scope.
     if(node->type == ast_stmt && node->stmt.type == ast_decl){
-        if (!symbolTableStack.empty()) {
-            //find symbol table at top of stack
-            SymbolTable& curr_table = symbolTableStack.top();
-            printf("size of current table : %ld %ld\n", symbolTableStack.size(), curr_table.size());
-            char* declName = node->stmt.decl.name;
-            // making sure declName is not null
-            if(declName == NULL){
-                fprintf(stderr, "Declaration name is null.\n");
+        if (symbols.depth() > 0) {
+            symbol_id declName = node->stmt.decl.name;
+            if (!symbols.declare(declName)) {
+                LOG_WARN("Variable has already been declared: '%s'", symbolName(declName));
                 return false;
             }
-            //iterate through symbol table
-            for (auto it : curr_table) {
-                if (strcmp(it, declName)==0) {
-                    printf("Error: Variable has already been declared: '%s'\n", declName);
-                    return false;
-                }
-            }
-            curr_table.push_back(declName);
-            //printf("size of current table : %ld %ld\n", symbolTableStack.size(), curr_table.size());
+            LOG_DEBUG("scope depth: %zu, scope size: %zu", symbols.depth(), symbols.scopeSize());
         }
     }
 
-    // if the node is a variable node, check if it appears in one of the symbol tables on the stack. 
-    // If it does not, then emit an error message with name of the variable.
+    // if the node is a variable node, check if it is visible from any open scope. 
+    // If it is not, then emit an error message with name of the variable.
     if(node->type == ast_var) {
-        char* varName = node->var.name;
-        // checking to make sure variable name isn't null
-        if(varName == NULL){
-            fprintf(stderr, "varName is null\n");
-            return false;
-        }
-        bool ifFound = false;  // bool to keep track of whether or not variable name has been foumd
-        stack<SymbolTable> curr_stack = symbolTableStack;  //initializing empty stack and copying current stack to it
-        while(!curr_stack.empty()) {
-            SymbolTable& tempTable = curr_stack.top();
-            // iterating through every symbol table in stack
-            for (auto it : tempTable) {
-                if (strcmp(it, varName) == 0) {
-                    ifFound = true;
-                    break;
-                }
-            }
-            curr_stack.pop();
-        }  
-        if (!ifFound) {
-                printf("Error: Variable has not been declared. '%s'\n", varName);
+        symbol_id varName = node->var.name;
+        if (!symbols.isDeclared(varName)) {
+                LOG_WARN("Variable has not been declared. '%s'", symbolName(varName));
                 return false;
         }
     }
@@ -136,50 +122,97 @@ bool visitNode(astNode* node, stack<SymbolTable>& symbolTableStack){
             // program nodes
         if (node->type == ast_prog) {
             // children
-            visitNode(node->prog.ext1, symbolTableStack);
-            visitNode(node->prog.ext2, symbolTableStack);
-            visitNode(node->prog.func, symbolTableStack);
+            pushVisit(visit_node, node->prog.func);
+            pushVisit(visit_node, node->prog.ext2);
+            pushVisit(visit_node, node->prog.ext1);
         }
         // statement nodes
         else if (node->type == ast_stmt) {
             switch (node->stmt.type) {
                 case ast_call:
+                    // read() has no param; don't fall through into ret, whose expr aliases the call's name
                     if(node->stmt.call.param !=nullptr){
-                        visitNode(node->stmt.call.param, symbolTableStack);
-                        break;
+                        pushVisit(visit_node, node->stmt.call.param);
                     }
+                    break;
                 case ast_ret:
-                    visitNode(node->stmt.ret.expr, symbolTableStack);
+                    // a bare "return;" has no expression to check
+                    if (node->stmt.ret.expr != nullptr) {
+                        pushVisit(visit_node, node->stmt.ret.expr);
+                    }
                     break;
                 case ast_while:
-                    visitNode(node->stmt.whilen.cond, symbolTableStack);
-                    visitNode(node->stmt.whilen.body, symbolTableStack);
+                    pushVisit(visit_node, node->stmt.whilen.body);
+                    pushVisit(visit_node, node->stmt.whilen.cond);
                     break;
                 case ast_if:
-                    visitNode(node->stmt.ifn.cond, symbolTableStack);
-                    visitNode(node->stmt.ifn.if_body, symbolTableStack);
                     if (node->stmt.ifn.else_body != NULL) {
-                        visitNode(node->stmt.ifn.else_body, symbolTableStack);
+                        pushVisit(visit_node, node->stmt.ifn.else_body);
                     }
+                    pushVisit(visit_node, node->stmt.ifn.if_body);
+                    pushVisit(visit_node, node->stmt.ifn.cond);
                     break;
                 case ast_asgn:
-                    visitNode(node->stmt.asgn.rhs, symbolTableStack);
-                    visitNode(node->stmt.asgn.lhs, symbolTableStack);
+                    // the right hand side is checked before the variable assigned to
+                    pushVisit(visit_node, node->stmt.asgn.lhs);
+                    pushVisit(visit_node, node->stmt.asgn.rhs);
+                    break;
+                default:
+                    // blocks and declarations were handled above
                     break;
             }
         }
         // expr nodes
         else if (node->type == ast_rexpr) {
-            visitNode(node->rexpr.lhs, symbolTableStack);
-            visitNode(node->rexpr.rhs, symbolTableStack);
+            pushVisit(visit_node, node->rexpr.rhs);
+            pushVisit(visit_node, node->rexpr.lhs);
         }
         else if (node->type == ast_bexpr) {
-            visitNode(node->bexpr.lhs, symbolTableStack);
-            visitNode(node->bexpr.rhs, symbolTableStack);
+            pushVisit(visit_node, node->bexpr.rhs);
+            pushVisit(visit_node, node->bexpr.lhs);
         }
         else if (node->type == ast_uexpr) {
-            visitNode(node->uexpr.expr, symbolTableStack);
+            pushVisit(visit_node, node->uexpr.expr);
         }
     }
     return true;
-}
\ No newline at end of file
+}
+
+bool visitNode(astNode* node, ScopedSymbolTable& symbols){
+    METRIC_PHASE(phase_visit);
+    size_t base = visitStack.size();
+    bool ok = true;
+    pushVisit(visit_node, node, true);
+    while (visitStack.size() > base) {
+        visitItem item = visitStack.back();
+        visitStack.pop_back();
+        switch (item.action) {
+            case visit_node:
+                // a failed check only fails the whole visit on the node visitNode was called on
+                if (!visitOne(item.node, symbols, item.root) && item.root) {
+                    ok = false;
+                }
+                break;
+            case visit_pop_scope:
+                symbols.popScope();
+                break;
+            case visit_null_func_stmt:
+                // handling possible errors where the stmt is a null pointer
+                LOG_ERROR("Statement node is null");
+                break;
+            case visit_null_block_stmt:
+                // the rest of the block is skipped and its scope popped
+                LOG_ERROR("Statement node is null.");
+                while (visitStack.back().action != visit_pop_scope) {
+                    visitStack.pop_back();
+                }
+                visitStack.pop_back();
+                symbols.popScope();
+                if (item.root) {
+                    ok = false;
+                }
+                break;
+        }
+    }
+    return ok;
+}
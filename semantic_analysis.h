@@ -7,24 +7,21 @@
 #ifndef SEMANTIC_ANALYSIS_H
 #define SEMANTIC_ANALYSIS_H
 
-#include <string>
-#include <vector>
-#include <stack>
 #include "ast.h"
-
-using SymbolTable = std::vector<char *>;
+#include "scoped_symbol_table.h"
 
 /**
- * This function recursively traverses AST nodes by starting with the root node and 
- * performs semantic analysis. Implements two rules per the spec:
+ * This function traverses AST nodes by starting with the root node and performs
+ * semantic analysis. The walk uses an explicit stack instead of recursion, so it
+ * is safe on threads with small stacks. Implements two rules per the spec:
  * -A variable is declared before it is used
  * -There is only one declaration of the variable in a scope
- * @param node is a pointer to the AST node being visited (initially root, then recursively all other nodes).
- * @param symbolTableStack is a reference to the symbol table stack.
+ * @param node is a pointer to the root of the subtree to visit.
+ * @param symbols is a reference to the scoped symbol table; scopes are pushed and popped as blocks are entered and left.
  * returns: true if function succesfully traversed AST and performed semantic analysis
  * false otherwise
  */
-bool visitNode(astNode* node, stack<SymbolTable>& symbolTableStack);
+bool visitNode(astNode* node, ScopedSymbolTable& symbols);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*
+*   MiniC Compiler - Sequence Alignment
+*
+*   Purpose: Comparing two statement lists element by element means a single inserted statement misaligns everything
+*   after it. This file finds the longest common subsequence of two key sequences with Myers' greedy O(ND)
+*   algorithm, which is linear for the common case of nearly identical lists, so blocks can be compared along the
+*   alignment instead of by position.
+*/
+
+#include <algorithm>
+#include "sequence_align.h"
+
+// The furthest reaching x of every diagonal k in [-d, d] after round d lives at trace[d * d + d + k];
+// round d takes 2d + 1 entries, so the rounds pack without gaps
+static thread_local std::vector<int32_t> trace;
+
+static inline int32_t& furthest(int32_t d, int32_t k) {
+    return trace[(size_t) d * d + d + k];
+}
+
+bool alignSequences(const uint64_t* a, uint32_t n, const uint64_t* b, uint32_t m, std::vector<AlignedPair>& matches) {
+    // the matching prefix and suffix need no search, and are usually most of the list
+    uint32_t prefix = 0;
+    while (prefix < n && prefix < m && a[prefix] == b[prefix]) {
+        prefix++;
+    }
+    uint32_t suffix = 0;
+    while (suffix < n - prefix && suffix < m - prefix && a[n - 1 - suffix] == b[m - 1 - suffix]) {
+        suffix++;
+    }
+    const uint64_t* x0 = a + prefix;
+    const uint64_t* y0 = b + prefix;
+    int32_t rows = (int32_t) (n - prefix - suffix), cols = (int32_t) (m - prefix - suffix);
+    int32_t limit = std::min<int32_t>(rows + cols, MAX_ALIGN_EDITS);
+
+    int32_t edits = -1;
+    for (int32_t d = 0; d <= limit && edits < 0; d++) {
+        if (trace.size() < (size_t) (d + 1) * (d + 1)) {
+            trace.resize((size_t) (d + 1) * (d + 1) * 2);
+        }
+        for (int32_t k = -d; k <= d; k += 2) {
+            int32_t x;
+            if (d == 0) {
+                x = 0;
+            } else if (k == -d || (k != d && furthest(d - 1, k - 1) < furthest(d - 1, k + 1))) {
+                x = furthest(d - 1, k + 1);     // step down: a key of b inserted
+            } else {
+                x = furthest(d - 1, k - 1) + 1; // step right: a key of a deleted
+            }
+            int32_t y = x - k;
+            while (x < rows && y < cols && x0[x] == y0[y]) {
+                x++;
+                y++;
+            }
+            furthest(d, k) = x;
+            if (x >= rows && y >= cols) {
+                edits = d;
+                break;
+            }
+        }
+    }
+    if (edits < 0) {
+        return false;
+    }
+
+    // walk the trace back from the end, collecting the diagonal (matching) steps in reverse
+    size_t first = matches.size();
+    for (uint32_t i = 0; i < suffix; i++) {
+        matches.push_back({n - 1 - i, m - 1 - i});
+    }
+    int32_t x = rows, y = cols;
+    for (int32_t d = edits; d > 0; d--) {
+        int32_t k = x - y;
+        int32_t previousK;
+        if (k == -d || (k != d && furthest(d - 1, k - 1) < furthest(d - 1, k + 1))) {
+            previousK = k + 1;
+        } else {
+            previousK = k - 1;
+        }
+        int32_t previousX = furthest(d - 1, previousK);
+        int32_t previousY = previousX - previousK;
+        while (x > previousX && y > previousY) {
+            x--;
+            y--;
+            matches.push_back({prefix + (uint32_t) x, prefix + (uint32_t) y});
+        }
+        x = previousX;
+        y = previousY;
+    }
+    while (x > 0 && y > 0) {
+        x--;
+        y--;
+        matches.push_back({prefix + (uint32_t) x, prefix + (uint32_t) y});
+    }
+    for (uint32_t i = prefix; i > 0; i--) {
+        matches.push_back({i - 1, i - 1});
+    }
+    std::reverse(matches.begin() + first, matches.end());
+    return true;
+}
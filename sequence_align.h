@@ -0,0 +1,34 @@
+/*
+* h file for sequence_align.cpp
+*
+* Longest common subsequence alignment of two key sequences with Myers' O(ND)
+* difference algorithm, where D is the number of inserted and deleted keys.
+* Block comparison uses it on the subtree hashes of two statement lists, so an
+* inserted statement no longer shifts every statement after it out of line.
+*/
+
+#ifndef SEQUENCE_ALIGN_H
+#define SEQUENCE_ALIGN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// beyond this many insertions plus deletions alignment gives up and callers fall back to pairing by position
+const uint32_t MAX_ALIGN_EDITS = 256;
+
+// Position i of the first sequence matched with position j of the second
+struct AlignedPair {
+    uint32_t first;
+    uint32_t second;
+};
+
+/**
+ * Appends the pairs of a longest common subsequence of a[0..n) and b[0..m) to matches,
+ * in increasing order. Scratch space is kept per thread and reused, so steady-state calls
+ * do not allocate.
+ * returns: false, appending nothing, if the sequences differ by more than MAX_ALIGN_EDITS edits.
+ */
+bool alignSequences(const uint64_t* a, uint32_t n, const uint64_t* b, uint32_t m, std::vector<AlignedPair>& matches);
+
+#endif
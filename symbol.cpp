@@ -0,0 +1,136 @@
+/*
+*   MiniC Compiler - Symbol Interning
+*
+*   Purpose: The scanner used to strdup every identifier, the create* functions copied it again and both semantic
+*   analysis and comparison then compared names character by character (or, in compare(), by pointer, which is
+*   wrong). Interning maps each distinct identifier to a dense integer once, at lex time, and keeps its only copy.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "symbol.h"
+
+// names are looked up by id through fixed-size pages so readers never see a reallocating array
+static const size_t PAGE_BITS = 12;
+static const size_t PAGE_SIZE = (size_t) 1 << PAGE_BITS;
+static const size_t MAX_PAGES = (size_t) 1 << 16;
+
+// spellings are copied into large chunks that are never freed or moved
+static const size_t CHUNK_SIZE = 64 * 1024;
+
+struct SymbolEntry {
+    const char* name;
+    uint64_t hash;
+};
+
+struct SymbolTableStore {
+    std::shared_mutex lock;
+    std::unordered_map<std::string_view, symbol_id> ids;
+    std::atomic<SymbolEntry*> pages[MAX_PAGES];
+    std::atomic<size_t> count;
+    char* cursor;
+    char* limit;
+
+    SymbolTableStore() : count(0), cursor(NULL), limit(NULL) {
+        for (size_t i = 0; i < MAX_PAGES; i++) {
+            pages[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+
+    // copies name into the chunk storage; called with the write lock held
+    const char* store(const char* name, size_t len) {
+        if ((size_t) (limit - cursor) < len + 1) {
+            size_t size = len + 1 > CHUNK_SIZE ? len + 1 : CHUNK_SIZE;
+            cursor = (char*) malloc(size);
+            if (cursor == NULL) {
+                throw std::bad_alloc();
+            }
+            limit = cursor + size;
+        }
+        char* copy = cursor;
+        memcpy(copy, name, len);
+        copy[len] = '\0';
+        cursor += len + 1;
+        return copy;
+    }
+};
+
+// FNV-1a over the spelling
+static uint64_t hashSpelling(const char* name, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// constructed on first use and intentionally never destroyed, so it outlives every tree
+static SymbolTableStore& symbolStore() {
+    static SymbolTableStore* table = new SymbolTableStore();
+    return *table;
+}
+
+symbol_id internSymbol(const char* name, size_t len) {
+    SymbolTableStore& table = symbolStore();
+    std::string_view key(name, len);
+    {
+        std::shared_lock<std::shared_mutex> guard(table.lock);
+        auto found = table.ids.find(key);
+        if (found != table.ids.end()) {
+            return found->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> guard(table.lock);
+    // another thread may have added it between the two locks
+    auto found = table.ids.find(key);
+    if (found != table.ids.end()) {
+        return found->second;
+    }
+
+    symbol_id id = (symbol_id) table.count.load(std::memory_order_relaxed);
+    size_t page = id >> PAGE_BITS;
+    if (page >= MAX_PAGES) {
+        throw std::bad_alloc();
+    }
+    if (table.pages[page].load(std::memory_order_relaxed) == NULL) {
+        table.pages[page].store((SymbolEntry*) calloc(PAGE_SIZE, sizeof(SymbolEntry)), std::memory_order_release);
+    }
+    const char* copy = table.store(name, len);
+    table.pages[page].load(std::memory_order_relaxed)[id & (PAGE_SIZE - 1)] = {copy, hashSpelling(name, len)};
+    table.ids.emplace(std::string_view(copy, len), id);
+    table.count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+symbol_id internSymbol(const char* name) {
+    return internSymbol(name, strlen(name));
+}
+
+const char* symbolName(symbol_id id) {
+    SymbolTableStore& table = symbolStore();
+    if (id >= table.count.load(std::memory_order_acquire)) {
+        return "<unknown symbol>";
+    }
+    return table.pages[id >> PAGE_BITS].load(std::memory_order_acquire)[id & (PAGE_SIZE - 1)].name;
+}
+
+uint64_t symbolHash(symbol_id id) {
+    SymbolTableStore& table = symbolStore();
+    if (id >= table.count.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    return table.pages[id >> PAGE_BITS].load(std::memory_order_acquire)[id & (PAGE_SIZE - 1)].hash;
+}
+
+size_t symbolCount() {
+    return symbolStore().count.load(std::memory_order_acquire);
+}
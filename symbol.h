@@ -0,0 +1,31 @@
+/*
+* h file for symbol.cpp
+*
+* Process-wide identifier interning. Every distinct name is stored once and
+* identified by a dense symbol_id, so name equality anywhere in the compiler is
+* an integer compare. The table is safe to use from several threads at once and
+* lives until the process exits.
+*/
+
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef uint32_t symbol_id;
+
+// Returns the id of name, adding it to the table on first use
+symbol_id internSymbol(const char* name);
+symbol_id internSymbol(const char* name, size_t len);
+
+// Returns the interned, NUL-terminated spelling of id
+const char* symbolName(symbol_id id);
+
+// Returns a 64-bit hash of id's spelling. Unlike the id itself it is the same in every run
+uint64_t symbolHash(symbol_id id);
+
+// Number of distinct names interned so far
+size_t symbolCount();
+
+#endif
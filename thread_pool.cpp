@@ -0,0 +1,119 @@
+/*
+*   MiniC Compiler - Work-Stealing Thread Pool
+*
+*   Purpose: Pair costs in the all-pairs comparison vary widely with AST size, so statically splitting the work between
+*   threads leaves most of them idle while one finishes the expensive tiles. Each worker here owns a deque and steals
+*   from the others when its own runs out, which keeps every core busy until the last task.
+*/
+
+#include "thread_pool.h"
+
+// index of the pool worker running on this thread, or -1 for threads outside any pool
+static thread_local int currentWorker = -1;
+static thread_local const WorkStealingPool* currentPool = NULL;
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : queued(0), pending(0), nextQueue(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) {
+            threads = 1;
+        }
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        queues.emplace_back(new WorkerQueue());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    unsigned target;
+    if (currentPool == this) {
+        target = (unsigned) currentWorker;
+    } else {
+        target = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+
+    // queued is bumped under idleLock, and before the push, so a worker about to sleep cannot miss
+    // the task and the counter never drops below the real number of queued tasks
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> guard(idleLock);
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> guard(idleLock);
+    allDone.wait(guard, [this] { return pending.load() == 0; });
+}
+
+// own work is taken LIFO so the most recently split tasks stay warm in this core's cache
+bool WorkStealingPool::popLocal(unsigned id, Task& task) {
+    WorkerQueue& queue = *queues[id];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+// stolen work is taken FIFO from the opposite end to keep contention with the owner low
+bool WorkStealingPool::steal(unsigned id, Task& task) {
+    size_t n = queues.size();
+    for (size_t k = 1; k < n; k++) {
+        WorkerQueue& victim = *queues[(id + k) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned id) {
+    currentWorker = (int) id;
+    currentPool = this;
+    Task task;
+    while (true) {
+        if (popLocal(id, task) || steal(id, task)) {
+            queued.fetch_sub(1);
+            task(id);
+            task = nullptr;
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(idleLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(idleLock);
+        workAvailable.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*
+* h file for thread_pool.cpp
+*
+* A small work-stealing thread pool. Every worker owns a deque of tasks: it pops
+* its own work from the back and, once that runs dry, steals from the front of
+* the other workers' deques. Tasks receive the index of the worker running them
+* so callers can keep per-thread state without locking.
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    typedef std::function<void(unsigned)> Task;
+
+    // threads == 0 uses the number of hardware threads
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * Queues a task. Tasks submitted from a worker go to that worker's own deque,
+     * all others are spread round robin over the workers.
+     */
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished
+    void wait();
+
+    unsigned size() const { return (unsigned) workers.size(); }
+
+private:
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned id);
+    bool popLocal(unsigned id, Task& task);
+    bool steal(unsigned id, Task& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued;     // tasks sitting in a deque
+    std::atomic<size_t> pending;    // tasks submitted but not yet finished
+    std::atomic<unsigned> nextQueue;
+    std::mutex idleLock;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*
+*   MiniC Compiler - Tree Edit Distance
+*
+*   Purpose: compareTrees lines statements up by position, so a single inserted statement makes every later one look
+*   different, and it only charges fixed deductions for what it happens to visit. This file computes the ordered tree
+*   edit distance between two flattened ASTs with the Zhang-Shasha keyroot algorithm, which aligns nodes optimally
+*   and charges the existing deductor constants per edited node.
+*/
+
+#include <algorithm>
+#include <vector>
+#include "tree_edit.h"
+
+// One node of the tree being numbered whose children are not all numbered yet
+struct PostOrderFrame {
+    uint32_t index;     // the node in the FlatAst
+    uint32_t child;     // its next child to number
+    uint32_t remaining; // children not numbered yet
+    uint32_t first;     // leftmost leaf of its first numbered child, 0 while there is none
+};
+
+// the scorer runs on pool threads, so the walk keeps its own stack instead of recursing once per tree level
+static thread_local std::vector<PostOrderFrame> postOrderStack;
+
+// appends the tree in post-order, skipping the flat_none placeholders
+static void addPostOrder(const FlatAstView& tree, EditTree& out) {
+    if (tree.kind[0] == flat_none) {
+        return;
+    }
+    postOrderStack.clear();
+    postOrderStack.push_back({0, 1, tree.childCount[0], 0});
+    while (!postOrderStack.empty()) {
+        PostOrderFrame& frame = postOrderStack.back();
+        if (frame.remaining > 0) {
+            uint32_t child = frame.child;
+            frame.child = tree.nextSibling(child);
+            frame.remaining--;
+            if (tree.kind[child] != flat_none) {
+                postOrderStack.push_back({child, child + 1, tree.childCount[child], 0});
+            }
+            continue;
+        }
+        // every child is numbered, so the node itself comes next
+        out.flatIndex.push_back(frame.index);
+        uint32_t number = out.size();
+        out.leftmost.push_back(frame.first != 0 ? frame.first : number);
+        postOrderStack.pop_back();
+        if (!postOrderStack.empty() && postOrderStack.back().first == 0) {
+            postOrderStack.back().first = out.leftmost[number];
+        }
+    }
+}
+
+void buildEditTree(const FlatAstView& tree, EditTree& out) {
+    out.flatIndex.assign(1, 0);
+    out.leftmost.assign(1, 0);
+    out.keyroots.clear();
+    if (tree.nodeCount() > 0) {
+        addPostOrder(tree, out);
+    }
+    // the highest node for every distinct leftmost leaf is a keyroot
+    std::vector<bool> seen(out.size() + 1, false);
+    for (uint32_t i = out.size(); i >= 1; i--) {
+        if (!seen[out.leftmost[i]]) {
+            seen[out.leftmost[i]] = true;
+            out.keyroots.push_back(i);
+        }
+    }
+    std::reverse(out.keyroots.begin(), out.keyroots.end());
+}
+
+static int relabelCost(const FlatAstView& tree1, uint32_t node1, const FlatAstView& tree2, uint32_t node2,
+                       const TreeEditCosts& costs) {
+    uint8_t kind = tree1.kind[node1];
+    if (kind != tree2.kind[node2]) {
+        return costs.relabelType;
+    }
+    if (tree1.op[node1] != tree2.op[node2]) {
+        return costs.relabelOp;
+    }
+    if (tree1.value[node1] == tree2.value[node2]) {
+        return 0;
+    }
+    if (kind == flat_cnst) {
+        return costs.relabelConst;
+    }
+    return kind == flat_decl ? costs.relabelDecl : costs.relabelName;
+}
+
+// The tables of the pairs scored on this thread, grown to the largest pair so far and never cleared: every cell a
+// pair reads is written earlier in the same pair. treeDist[i][j] is the distance between the subtrees rooted at i
+// and j; forest is reused for every keyroot pair and indexed relative to the two keyroots' leftmost leaves
+static thread_local std::vector<int> treeDistScratch;
+static thread_local std::vector<int> forestScratch;
+
+int treeEditDistance(const FlatAstView& tree1, const FlatAstView& tree2, const TreeEditCosts& costs) {
+    EditTree a, b;
+    buildEditTree(tree1, a);
+    buildEditTree(tree2, b);
+    return treeEditDistance(tree1, a, tree2, b, costs);
+}
+
+int treeEditDistance(const FlatAstView& tree1, const EditTree& a, const FlatAstView& tree2, const EditTree& b,
+                     const TreeEditCosts& costs) {
+    uint32_t n = a.size(), m = b.size();
+    if (n == 0 || m == 0) {
+        return n * costs.remove + m * costs.insert;
+    }
+
+    // bound once here, so the inner loops do not go through the thread_local wrappers on every access
+    std::vector<int>& treeDist = treeDistScratch;
+    std::vector<int>& forest = forestScratch;
+    size_t stride = m + 1;
+    if (treeDist.size() < (size_t) (n + 1) * stride) {
+        treeDist.resize((size_t) (n + 1) * stride);
+    }
+    for (uint32_t root1 : a.keyroots) {
+        for (uint32_t root2 : b.keyroots) {
+            uint32_t left1 = a.leftmost[root1], left2 = b.leftmost[root2];
+            uint32_t rows = root1 - left1 + 2, cols = root2 - left2 + 2;
+            if (forest.size() < (size_t) rows * cols) {
+                forest.resize((size_t) rows * cols);
+            }
+            forest[0] = 0;
+            for (uint32_t i = 1; i < rows; i++) {
+                forest[i * cols] = forest[(i - 1) * cols] + costs.remove;
+            }
+            for (uint32_t j = 1; j < cols; j++) {
+                forest[j] = forest[j - 1] + costs.insert;
+            }
+
+            for (uint32_t i = 1; i < rows; i++) {
+                uint32_t node1 = left1 + i - 1;
+                for (uint32_t j = 1; j < cols; j++) {
+                    uint32_t node2 = left2 + j - 1;
+                    int removed = forest[(i - 1) * cols + j] + costs.remove;
+                    int inserted = forest[i * cols + j - 1] + costs.insert;
+                    int best = std::min(removed, inserted);
+                    if (a.leftmost[node1] == left1 && b.leftmost[node2] == left2) {
+                        // both forests are whole trees: match the two roots
+                        int relabeled = forest[(i - 1) * cols + j - 1] +
+                                        relabelCost(tree1, a.flatIndex[node1], tree2, b.flatIndex[node2], costs);
+                        best = std::min(best, relabeled);
+                        treeDist[node1 * stride + node2] = best;
+                    } else {
+                        // match the subtree at node1 to the one at node2 as already computed
+                        uint32_t before1 = a.leftmost[node1] - left1, before2 = b.leftmost[node2] - left2;
+                        best = std::min(best, forest[before1 * cols + before2] + treeDist[node1 * stride + node2]);
+                    }
+                    forest[i * cols + j] = best;
+                }
+            }
+        }
+    }
+    return treeDist[n * stride + m];
+}
+
+int treeEditScore(const FlatAstView& tree1, const FlatAstView& tree2, const TreeEditCosts& costs) {
+    EditTree a, b;
+    buildEditTree(tree1, a);
+    buildEditTree(tree2, b);
+    return treeEditScore(tree1, a, tree2, b, costs);
+}
+
+int treeEditScore(const FlatAstView& tree1, const EditTree& a, const FlatAstView& tree2, const EditTree& b,
+                  const TreeEditCosts& costs) {
+    long worst = (long) a.size() * costs.remove + (long) b.size() * costs.insert;
+    if (worst == 0) {
+        return 100;
+    }
+    long distance = std::min<long>(treeEditDistance(tree1, a, tree2, b, costs), worst);
+    return (int) (100 - (100 * distance + worst / 2) / worst);
+}
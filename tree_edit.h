@@ -0,0 +1,72 @@
+/*
+* h file for tree_edit.cpp
+*
+* Ordered tree edit distance (Zhang and Shasha) over flattened ASTs, as an
+* alternative to the positional compareTrees heuristic. The distance is the
+* cheapest sequence of node deletions, insertions and relabelings turning one
+* tree into the other, so reordered, inserted or removed statements are
+* charged for what actually changed instead of misaligning everything after
+* them. flat_none placeholders are not nodes of the edit tree.
+*
+* The keyroot decomposition needs one (n + 1) x (m + 1) table of subtree
+* distances and one forest table reused across keyroot pairs, at most as large,
+* so two 5000 node programs take about 200 MB and a few seconds; time is
+* O(n m min(depth, leaves)^2). Each thread keeps its tables from pair to pair,
+* so they grow to the largest pair it has scored instead of being allocated for
+* every pair, and batch runs build the EditTree of each submission only once.
+*/
+
+#ifndef TREE_EDIT_H
+#define TREE_EDIT_H
+
+#include <cstdint>
+#include <vector>
+#include "flat_ast.h"
+#include "inclass.h"
+
+// Cost of each edit operation, by default the deductors compareTrees charges for the same differences
+struct TreeEditCosts {
+    int remove = NULL_NODE_DEDUCTOR;             // a node only the first tree has
+    int insert = NULL_NODE_DEDUCTOR;             // a node only the second tree has
+    int relabelType = TYPE_MISMATCH_DEDUCTOR;    // a node of a different kind
+    int relabelName = NAME_MISMATCH_DEDUCTOR;    // same kind, different identifier
+    int relabelDecl = DECL_NAME_MISMATCH_DEDUCTOR; // a declaration of a different name
+    int relabelOp = NAME_MISMATCH_DEDUCTOR;      // same expression kind, different operator
+    int relabelConst = 0;                        // constants of different value; compareTrees ignores them
+};
+
+// largest cost of a single edit; keeps the distance of two 100k node programs within an int
+const int MAX_EDIT_COST = 10000;
+
+// A tree renumbered in post-order (1-based, 0 unused) without the flat_none placeholders
+struct EditTree {
+    std::vector<uint32_t> flatIndex; // node in the FlatAst
+    std::vector<uint32_t> leftmost;  // post-order number of the leftmost leaf below each node
+    std::vector<uint32_t> keyroots;  // nodes with no ancestor sharing their leftmost leaf, ascending
+
+    // nodes taking part in the edit distance
+    uint32_t size() const { return flatIndex.empty() ? 0 : (uint32_t) flatIndex.size() - 1; }
+};
+
+// Builds the edit tree of tree, replacing whatever out held
+void buildEditTree(const FlatAstView& tree, EditTree& out);
+
+// Returns the minimum total cost of edits turning tree1 into tree2
+int treeEditDistance(const FlatAstView& tree1, const FlatAstView& tree2, const TreeEditCosts& costs = TreeEditCosts());
+
+// The same, for trees whose edit trees are already built
+int treeEditDistance(const FlatAstView& tree1, const EditTree& edit1, const FlatAstView& tree2, const EditTree& edit2,
+                     const TreeEditCosts& costs = TreeEditCosts());
+
+/**
+ * Scores two trees from 0 to 100: 100 for identical trees, 0 when nothing cheaper than deleting
+ * all of tree1 and inserting all of tree2 exists. Unlike compareTrees the score does not depend
+ * on program size, since the distance is taken relative to that worst case.
+ */
+int treeEditScore(const FlatAstView& tree1, const FlatAstView& tree2, const TreeEditCosts& costs = TreeEditCosts());
+
+// The same, for trees whose edit trees are already built
+int treeEditScore(const FlatAstView& tree1, const EditTree& edit1, const FlatAstView& tree2, const EditTree& edit2,
+                  const TreeEditCosts& costs = TreeEditCosts());
+
+#endif
@@ -0,0 +1,1851 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison implementation for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* C LALR(1) parser skeleton written by Richard Stallman, by
+   simplifying the original so-called "semantic" parser.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+/* All symbols defined below should begin with yy or YY, to avoid
+   infringing on user name space.  This should be done even for local
+   variables, as they might otherwise be expanded by user macros.
+   There are some unavoidable exceptions within include files to
+   define necessary library symbols; they are noted "INFRINGES ON
+   USER NAME SPACE" below.  */
+
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
+
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
+
+/* Skeleton name.  */
+#define YYSKELETON_NAME "yacc.c"
+
+/* Pure parsers.  */
+#define YYPURE 2
+
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
+
+
+
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
+
+#include "yacc.tab.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_NUM = 3,                        /* NUM  */
+  YYSYMBOL_ID = 4,                         /* ID  */
+  YYSYMBOL_PLUS = 5,                       /* PLUS  */
+  YYSYMBOL_MINUS = 6,                      /* MINUS  */
+  YYSYMBOL_MULT = 7,                       /* MULT  */
+  YYSYMBOL_DIV = 8,                        /* DIV  */
+  YYSYMBOL_INT = 9,                        /* INT  */
+  YYSYMBOL_EXTERN = 10,                    /* EXTERN  */
+  YYSYMBOL_VOID = 11,                      /* VOID  */
+  YYSYMBOL_IF = 12,                        /* IF  */
+  YYSYMBOL_ELSE = 13,                      /* ELSE  */
+  YYSYMBOL_WHILE = 14,                     /* WHILE  */
+  YYSYMBOL_RETURN = 15,                    /* RETURN  */
+  YYSYMBOL_READ = 16,                      /* READ  */
+  YYSYMBOL_PRINT = 17,                     /* PRINT  */
+  YYSYMBOL_EQ = 18,                        /* EQ  */
+  YYSYMBOL_GT = 19,                        /* GT  */
+  YYSYMBOL_LT = 20,                        /* LT  */
+  YYSYMBOL_GTE = 21,                       /* GTE  */
+  YYSYMBOL_LTE = 22,                       /* LTE  */
+  YYSYMBOL_EQUALS = 23,                    /* EQUALS  */
+  YYSYMBOL_THEN = 24,                      /* THEN  */
+  YYSYMBOL_25_ = 25,                       /* '('  */
+  YYSYMBOL_26_ = 26,                       /* ')'  */
+  YYSYMBOL_27_ = 27,                       /* ';'  */
+  YYSYMBOL_28_ = 28,                       /* '{'  */
+  YYSYMBOL_29_ = 29,                       /* '}'  */
+  YYSYMBOL_YYACCEPT = 30,                  /* $accept  */
+  YYSYMBOL_func = 31,                      /* func  */
+  YYSYMBOL_32_1 = 32,                      /* $@1  */
+  YYSYMBOL_33_2 = 33,                      /* $@2  */
+  YYSYMBOL_prog = 34,                      /* prog  */
+  YYSYMBOL_extern_list = 35,               /* extern_list  */
+  YYSYMBOL_block_open = 36,                /* block_open  */
+  YYSYMBOL_block_stmt = 37,                /* block_stmt  */
+  YYSYMBOL_var_decls = 38,                 /* var_decls  */
+  YYSYMBOL_decl = 39,                      /* decl  */
+  YYSYMBOL_stmts = 40,                     /* stmts  */
+  YYSYMBOL_print = 41,                     /* print  */
+  YYSYMBOL_stmt = 42,                      /* stmt  */
+  YYSYMBOL_cond_expr = 43,                 /* cond_expr  */
+  YYSYMBOL_expr = 44,                      /* expr  */
+  YYSYMBOL_term = 45                       /* term  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
+
+
+
+/* Unqualified %code blocks.  */
+#line 26 "yacc.y"
+
+#include <stdio.h>
+#include <vector>
+#include <stack>
+#include "scoped_symbol_table.h"
+#include <string>
+#include <atomic>
+#include "logging.h"
+#include "metrics.h"
+#include "scanner.h"
+
+// Semantic checks done while parsing: the scopes open at the current point of the input, and whether the block
+// about to open is a function body, whose declarations share the scope of the parameter. Tokens come from mapped
+// when it is set and from the flex scanner otherwise
+struct ParseContext {
+    ScopedSymbolTable symbols;
+    bool functionBody = false;
+    MiniCScanner *mapped = NULL;
+};
+
+extern int yylex(YYSTYPE *yylval_param, yyscan_t scanner);
+extern int yylex_init(yyscan_t *scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern void yyset_in(FILE *in, yyscan_t scanner);
+extern int yyget_lineno(yyscan_t scanner);
+void yyerror(yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context, const char *s);
+static void declareVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name);
+static void useVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name);
+
+// the parser reads its tokens through here, from whichever scanner the file is read with. Tokens are counted
+// (and, with MINIC_METRICS=2, the scanner is timed)
+static int nextToken(YYSTYPE *value, yyscan_t scanner, ParseContext *context) {
+    METRIC_LEX_PHASE();
+    METRIC_COUNT(counter_tokens, 1);
+    if (context->mapped == NULL) {
+        return yylex(value, scanner);
+    }
+    MappedToken token;
+    int kind = context->mapped->next(token);
+    if (kind == ID) {
+        value->sym = context->mapped->symbol(token);
+    } else if (kind == NUM) {
+        value->ival = context->mapped->number(token);
+    }
+    return kind;
+}
+#define yylex nextToken
+
+static int currentLine(yyscan_t scanner, ParseContext *context) {
+    return context->mapped != NULL ? context->mapped->line() : yyget_lineno(scanner);
+}
+
+#line 202 "yacc.tab.c"
+
+#ifdef short
+# undef short
+#endif
+
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
+#endif
+
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
+#else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
+#else
+typedef short yytype_uint8;
+#endif
+
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
+#else
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
+#endif
+
+#ifndef YYSIZE_T
+# ifdef __SIZE_TYPE__
+#  define YYSIZE_T __SIZE_TYPE__
+# elif defined size_t
+#  define YYSIZE_T size_t
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYSIZE_T size_t
+# else
+#  define YYSIZE_T unsigned
+# endif
+#endif
+
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_int8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
+
+#ifndef YY_
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
+# endif
+#endif
+
+/* Suppress unused-variable warnings by "using" E.  */
+#if ! defined lint || defined __GNUC__
+# define YY_USE(E) ((void) (E))
+#else
+# define YY_USE(E) /* empty */
+#endif
+
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
+#else
+# define YY_INITIAL_VALUE(Value) Value
+#endif
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
+#endif
+
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
+
+/* The parser invokes alloca or malloc; define the necessary symbols.  */
+
+# ifdef YYSTACK_USE_ALLOCA
+#  if YYSTACK_USE_ALLOCA
+#   ifdef __GNUC__
+#    define YYSTACK_ALLOC __builtin_alloca
+#   elif defined __BUILTIN_VA_ARG_INCR
+#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
+#   elif defined _AIX
+#    define YYSTACK_ALLOC __alloca
+#   elif defined _MSC_VER
+#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
+#    define alloca _alloca
+#   else
+#    define YYSTACK_ALLOC alloca
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
+#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
+#     endif
+#    endif
+#   endif
+#  endif
+# endif
+
+# ifdef YYSTACK_ALLOC
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+    /* The OS might guarantee only one guard page at the bottom of the stack,
+       and a page size can be as small as 4096 bytes.  So we cannot safely
+       invoke alloca (N) if N exceeds 4096.  Use a slightly smaller number
+       to allow for a few compiler-allocated temporary stack slots.  */
+#   define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
+#  endif
+# else
+#  define YYSTACK_ALLOC YYMALLOC
+#  define YYSTACK_FREE YYFREE
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+#   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
+#  endif
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
+       && ! ((defined YYMALLOC || defined malloc) \
+             && (defined YYFREE || defined free)))
+#   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
+#   endif
+#  endif
+#  ifndef YYMALLOC
+#   define YYMALLOC malloc
+#   if ! defined malloc && ! defined EXIT_SUCCESS
+void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+#  ifndef YYFREE
+#   define YYFREE free
+#   if ! defined free && ! defined EXIT_SUCCESS
+void free (void *); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+# endif
+#endif /* !defined yyoverflow */
+
+#if (! defined yyoverflow \
+     && (! defined __cplusplus \
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+
+/* A type that is properly aligned for any stack member.  */
+union yyalloc
+{
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
+
+/* The size of the maximum gap between one aligned stack and the next.  */
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
+
+/* The size of an array large to enough to hold all stacks, each with
+   N elements.  */
+# define YYSTACK_BYTES(N) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
+      + YYSTACK_GAP_MAXIMUM)
+
+# define YYCOPY_NEEDED 1
+
+/* Relocate STACK from its old location to the new one.  The
+   local variables YYSIZE and YYSTACKSIZE give the old and new number of
+   elements in the stack, and YYPTR gives the new location of the
+   stack.  Advance YYPTR to a properly aligned location for the next
+   stack.  */
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
+
+#endif
+
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
+/* YYFINAL -- State number of the termination state.  */
+#define YYFINAL  6
+/* YYLAST -- Last index in YYTABLE.  */
+#define YYLAST   116
+
+/* YYNTOKENS -- Number of terminals.  */
+#define YYNTOKENS  30
+/* YYNNTS -- Number of nonterminals.  */
+#define YYNNTS  16
+/* YYNRULES -- Number of rules.  */
+#define YYNRULES  40
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  101
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   279
+
+
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
+
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
+{
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+      25,    26,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,    27,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,    28,     2,    29,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24
+};
+
+#if YYDEBUG
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
+{
+       0,   113,   113,   113,   126,   126,   142,   152,   153,   157,
+     166,   190,   206,   208,   212,   222,   226,   236,   239,   240,
+     241,   242,   243,   244,   245,   246,   247,   250,   251,   252,
+     253,   254,   257,   258,   259,   260,   261,   262,   265,   266,
+     267
+};
+#endif
+
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
+/* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
+   First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
+static const char *const yytname[] =
+{
+  "\"end of file\"", "error", "\"invalid token\"", "NUM", "ID", "PLUS",
+  "MINUS", "MULT", "DIV", "INT", "EXTERN", "VOID", "IF", "ELSE", "WHILE",
+  "RETURN", "READ", "PRINT", "EQ", "GT", "LT", "GTE", "LTE", "EQUALS",
+  "THEN", "'('", "')'", "';'", "'{'", "'}'", "$accept", "func", "$@1",
+  "$@2", "prog", "extern_list", "block_open", "block_stmt", "var_decls",
+  "decl", "stmts", "print", "stmt", "cond_expr", "expr", "term", YY_NULLPTR
+};
+
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
+{
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-40)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-1)
+
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int8 yypact[] =
+{
+      -5,    16,    31,    -5,    10,    -1,   -40,    23,    14,    17,
+      40,   -40,    24,    42,    27,    29,    36,    -6,   -40,    30,
+      61,   -40,   -40,    43,    46,   -40,   -40,    49,   -40,    46,
+      53,    74,    58,    62,    64,    63,   -40,    49,   -40,     0,
+     -40,   -40,   -40,    69,    59,    69,    69,   -40,   -40,    18,
+      65,    69,   -40,    66,     2,    69,   -40,    26,   -40,   -40,
+      75,   -40,    68,    78,    77,   -40,    79,    80,   -40,    18,
+      18,    18,    18,    81,   -40,   -40,    67,    69,    69,    69,
+      69,    69,    46,   -40,    82,   -40,   -40,   -40,   -40,    83,
+      88,   -40,   -40,   -40,   -40,   -40,   -40,   -40,   -40,    67,
+     -40
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       0,     0,     0,     0,     0,     0,     1,     0,     0,     0,
+       0,     6,     0,     0,     0,     0,     0,     0,     8,     0,
+       0,     2,     7,     0,     0,     4,     9,     0,     3,     0,
+       0,     0,     0,     0,     0,     0,    24,     0,    13,     0,
+      26,    16,     5,     0,     0,     0,     0,    38,    39,     0,
+       0,     0,    21,     0,    37,     0,    12,     0,    11,    15,
+       0,    14,     0,     0,     0,    40,     0,     0,    23,     0,
+       0,     0,     0,     0,    10,    25,     0,     0,     0,     0,
+       0,     0,     0,    36,     0,    32,    33,    34,    35,     0,
+      18,    27,    28,    29,    30,    31,    20,    22,    17,     0,
+      19
+};
+
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
+{
+     -40,   -40,   -40,   -40,   -40,    89,   -40,   -23,   -40,    71,
+      76,   -40,   -39,    70,   -32,   -36
+};
+
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_int8 yydefgoto[] =
+{
+       0,    11,    24,    29,     2,     3,    27,    36,    37,    38,
+      39,    40,    41,    62,    63,    54
+};
+
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int8 yytable[] =
+{
+      59,    28,    53,    20,    30,     1,    42,    69,    70,    71,
+      72,    60,    32,    65,    33,    34,     9,    35,    59,    67,
+      21,    47,    48,    73,    49,     4,     8,     5,    26,    58,
+      30,     6,    10,    85,    86,    87,    88,    90,    32,    12,
+      33,    34,    13,    35,    14,    91,    92,    93,    94,    95,
+      15,    16,    17,    30,    26,    74,    18,    22,    31,    96,
+     100,    32,    19,    33,    34,    23,    35,    47,    48,    25,
+      49,    30,    47,    48,    26,    49,    43,    26,    44,    32,
+      50,    33,    34,    45,    35,    50,    61,    46,    55,    51,
+      66,    52,     7,    68,    76,    26,    77,    78,    79,    80,
+      81,    99,    75,    82,     0,    83,    84,    89,    56,    97,
+      98,     0,     0,    57,     0,     0,    64
+};
+
+static const yytype_int8 yycheck[] =
+{
+      39,    24,    34,     9,     4,    10,    29,     5,     6,     7,
+       8,    43,    12,    49,    14,    15,    17,    17,    57,    51,
+      26,     3,     4,    55,     6,     9,    16,    11,    28,    29,
+       4,     0,     9,    69,    70,    71,    72,    76,    12,    25,
+      14,    15,    25,    17,     4,    77,    78,    79,    80,    81,
+      26,     9,    25,     4,    28,    29,    27,    27,     9,    82,
+      99,    12,    26,    14,    15,     4,    17,     3,     4,    26,
+       6,     4,     3,     4,    28,     6,    23,    28,     4,    12,
+      16,    14,    15,    25,    17,    16,    27,    25,    25,    25,
+      25,    27,     3,    27,    26,    28,    18,    19,    20,    21,
+      22,    13,    27,    26,    -1,    26,    26,    26,    37,    27,
+      27,    -1,    -1,    37,    -1,    -1,    46
+};
+
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
+{
+       0,    10,    34,    35,     9,    11,     0,    35,    16,    17,
+       9,    31,    25,    25,     4,    26,     9,    25,    27,    26,
+       9,    26,    27,     4,    32,    26,    28,    36,    37,    33,
+       4,     9,    12,    14,    15,    17,    37,    38,    39,    40,
+      41,    42,    37,    23,     4,    25,    25,     3,     4,     6,
+      16,    25,    27,    44,    45,    25,    39,    40,    29,    42,
+      44,    27,    43,    44,    43,    45,    25,    44,    27,     5,
+       6,     7,     8,    44,    29,    27,    26,    18,    19,    20,
+      21,    22,    26,    26,    26,    45,    45,    45,    45,    26,
+      42,    44,    44,    44,    44,    44,    37,    27,    27,    13,
+      42
+};
+
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    30,    32,    31,    33,    31,    34,    35,    35,    36,
+      37,    37,    38,    38,    39,    40,    40,    41,    42,    42,
+      42,    42,    42,    42,    42,    42,    42,    43,    43,    43,
+      43,    43,    44,    44,    44,    44,    44,    44,    45,    45,
+      45
+};
+
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     0,     6,     0,     8,     3,     7,     6,     1,
+       4,     3,     2,     1,     3,     2,     1,     5,     5,     7,
+       5,     2,     5,     3,     1,     4,     1,     3,     3,     3,
+       3,     3,     3,     3,     3,     3,     3,     1,     1,     1,
+       2
+};
+
+
+enum { YYENOMEM = -2 };
+
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
+
+
+#define YYRECOVERING()  (!!yyerrstatus)
+
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (scanner, root, diag, context, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
+
+
+/* Enable debugging if requested.  */
+#if YYDEBUG
+
+# ifndef YYFPRINTF
+#  include <stdio.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYFPRINTF fprintf
+# endif
+
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value, scanner, root, diag, context); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
+static void
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context)
+{
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (scanner);
+  YY_USE (root);
+  YY_USE (diag);
+  YY_USE (context);
+  if (!yyvaluep)
+    return;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
+
+static void
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context)
+{
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
+
+  yy_symbol_value_print (yyo, yykind, yyvaluep, scanner, root, diag, context);
+  YYFPRINTF (yyo, ")");
+}
+
+/*------------------------------------------------------------------.
+| yy_stack_print -- Print the state stack from its BOTTOM up to its |
+| TOP (included).                                                   |
+`------------------------------------------------------------------*/
+
+static void
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
+{
+  YYFPRINTF (stderr, "Stack now");
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
+  YYFPRINTF (stderr, "\n");
+}
+
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
+
+
+/*------------------------------------------------.
+| Report that the YYRULE is going to be reduced.  |
+`------------------------------------------------*/
+
+static void
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context)
+{
+  int yylno = yyrline[yyrule];
+  int yynrhs = yyr2[yyrule];
+  int yyi;
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
+  /* The symbols being reduced.  */
+  for (yyi = 0; yyi < yynrhs; yyi++)
+    {
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], scanner, root, diag, context);
+      YYFPRINTF (stderr, "\n");
+    }
+}
+
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule, scanner, root, diag, context); \
+} while (0)
+
+/* Nonzero means print parse trace.  It is left uninitialized so that
+   multiple parsers can coexist.  */
+int yydebug;
+#else /* !YYDEBUG */
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
+# define YY_STACK_PRINT(Bottom, Top)
+# define YY_REDUCE_PRINT(Rule)
+#endif /* !YYDEBUG */
+
+
+/* YYINITDEPTH -- initial size of the parser's stacks.  */
+#ifndef YYINITDEPTH
+# define YYINITDEPTH 200
+#endif
+
+/* YYMAXDEPTH -- maximum size the stacks can grow to (effective only
+   if the built-in stack extension method is used).
+
+   Do not make this value too large; the results are undefined if
+   YYSTACK_ALLOC_MAXIMUM < YYSTACK_BYTES (YYMAXDEPTH)
+   evaluated with infinite-precision integer arithmetic.  */
+
+#ifndef YYMAXDEPTH
+# define YYMAXDEPTH 10000
+#endif
+
+
+
+
+
+
+/*-----------------------------------------------.
+| Release the memory associated to this symbol.  |
+`-----------------------------------------------*/
+
+static void
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context)
+{
+  YY_USE (yyvaluep);
+  YY_USE (scanner);
+  YY_USE (root);
+  YY_USE (diag);
+  YY_USE (context);
+  if (!yymsg)
+    yymsg = "Deleting";
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+}
+
+
+
+
+
+
+/*----------.
+| yyparse.  |
+`----------*/
+
+int
+yyparse (yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context)
+{
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
+
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
+
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
+
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
+
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
+  /* The variables used to return semantic value and location from the
+     action routines.  */
+  YYSTYPE yyval;
+
+
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
+  /* The number of symbols on the RHS of the reduced rule.
+     Keep to zero when no symbol should be popped.  */
+  int yylen = 0;
+
+  YYDPRINTF ((stderr, "Starting parse\n"));
+
+  yychar = YYEMPTY; /* Cause a token to be read.  */
+
+  goto yysetstate;
+
+
+/*------------------------------------------------------------.
+| yynewstate -- push a new state, which is found in yystate.  |
+`------------------------------------------------------------*/
+yynewstate:
+  /* In all cases, when you get here, the value and location stacks
+     have just been pushed.  So pushing a state here evens the stacks.  */
+  yyssp++;
+
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
+
+  if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
+    {
+      /* Get the current used size of the three stacks, in elements.  */
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
+
+# if defined yyoverflow
+      {
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
+      }
+# else /* defined YYSTACK_RELOCATE */
+      /* Extend the stack our own way.  */
+      if (YYMAXDEPTH <= yystacksize)
+        YYNOMEM;
+      yystacksize *= 2;
+      if (YYMAXDEPTH < yystacksize)
+        yystacksize = YYMAXDEPTH;
+
+      {
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+#  undef YYSTACK_RELOCATE
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
+      }
+# endif
+
+      yyssp = yyss + yysize - 1;
+      yyvsp = yyvs + yysize - 1;
+
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
+
+      if (yyss + yystacksize - 1 <= yyssp)
+        YYABORT;
+    }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
+
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
+
+  goto yybackup;
+
+
+/*-----------.
+| yybackup.  |
+`-----------*/
+yybackup:
+  /* Do appropriate processing given the current state.  Read a
+     lookahead token if we need one and don't already have one.  */
+
+  /* First try to decide what to do without reference to lookahead token.  */
+  yyn = yypact[yystate];
+  if (yypact_value_is_default (yyn))
+    goto yydefault;
+
+  /* Not known => get a lookahead token if don't already have one.  */
+
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
+  if (yychar == YYEMPTY)
+    {
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, scanner, context);
+    }
+
+  if (yychar <= YYEOF)
+    {
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
+      YYDPRINTF ((stderr, "Now at end of input.\n"));
+    }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
+  else
+    {
+      yytoken = YYTRANSLATE (yychar);
+      YY_SYMBOL_PRINT ("Next token is", yytoken, &yylval, &yylloc);
+    }
+
+  /* If the proper action on seeing token YYTOKEN is to reduce or to
+     detect an error, take that action.  */
+  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)
+    goto yydefault;
+  yyn = yytable[yyn];
+  if (yyn <= 0)
+    {
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
+      yyn = -yyn;
+      goto yyreduce;
+    }
+
+  /* Count tokens shifted since error; after three, turn off error
+     status.  */
+  if (yyerrstatus)
+    yyerrstatus--;
+
+  /* Shift the lookahead token.  */
+  YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
+  yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
+  goto yynewstate;
+
+
+/*-----------------------------------------------------------.
+| yydefault -- do the default action for the current state.  |
+`-----------------------------------------------------------*/
+yydefault:
+  yyn = yydefact[yystate];
+  if (yyn == 0)
+    goto yyerrlab;
+  goto yyreduce;
+
+
+/*-----------------------------.
+| yyreduce -- do a reduction.  |
+`-----------------------------*/
+yyreduce:
+  /* yyn is the number of a rule to reduce with.  */
+  yylen = yyr2[yyn];
+
+  /* If YYLEN is nonzero, implement the default value of the action:
+     '$$ = $1'.
+
+     Otherwise, the following line sets YYVAL to garbage.
+     This behavior is undocumented and Bison
+     users should not rely upon it.  Assigning to YYVAL
+     unconditionally makes the parser a bit smaller, and it avoids a
+     GCC warning that YYVAL may be used uninitialized.  */
+  yyval = yyvsp[1-yylen];
+
+
+  YY_REDUCE_PRINT (yyn);
+  switch (yyn)
+    {
+  case 2: /* $@1: %empty  */
+#line 113 "yacc.y"
+                      {
+    context->symbols.pushScope();
+    context->functionBody = true;
+    }
+#line 1231 "yacc.tab.c"
+    break;
+
+  case 3: /* func: INT ID '(' ')' $@1 block_stmt  */
+#line 116 "yacc.y"
+                 {
+    context->symbols.popScope();
+    (yyval.nptr) = createFunc((yyvsp[-4].sym), NULL, (yyvsp[0].nptr));
+    if ((yyval.nptr) == NULL) {
+        yyerror(scanner, root, diag, context, "Failed to create function node due to memory allocation failure.");
+        YYABORT;
+    }
+    LOG_DEBUG("line %d: function '%s' created", currentLine(scanner, context), symbolName((yyvsp[-4].sym)));
+	}
+#line 1245 "yacc.tab.c"
+    break;
+
+  case 4: /* $@2: %empty  */
+#line 126 "yacc.y"
+                             {
+    // the parameter is declared in the scope the body's declarations go into
+    context->symbols.pushScope();
+    context->symbols.declare((yyvsp[-1].sym));
+    context->functionBody = true;
+    }
+#line 1256 "yacc.tab.c"
+    break;
+
+  case 5: /* func: INT ID '(' INT ID ')' $@2 block_stmt  */
+#line 131 "yacc.y"
+                 {
+    context->symbols.popScope();
+    (yyval.nptr) = createFunc((yyvsp[-6].sym), createVar((yyvsp[-3].sym)), (yyvsp[0].nptr));
+    if ((yyval.nptr) == NULL || (yyvsp[0].nptr) == NULL) {
+        yyerror(scanner, root, diag, context, "Failed to create function node with parameters due to memory allocation failure.");
+        YYABORT;
+    }
+    LOG_DEBUG("line %d: function '%s' with parameter '%s' created", currentLine(scanner, context), symbolName((yyvsp[-6].sym)), symbolName((yyvsp[-3].sym)));
+}
+#line 1270 "yacc.tab.c"
+    break;
+
+  case 6: /* prog: extern_list extern_list func  */
+#line 142 "yacc.y"
+                                    {
+    (yyval.nptr) = createProg((yyvsp[-2].nptr), (yyvsp[-1].nptr), (yyvsp[0].nptr));
+    if ((yyval.nptr) == NULL) {
+        yyerror(scanner, root, diag, context, "Failed to create program node due to memory allocation failure.");
+        YYABORT;
+    }
+    *root = (yyval.nptr);
+}
+#line 1283 "yacc.tab.c"
+    break;
+
+  case 7: /* extern_list: EXTERN VOID PRINT '(' INT ')' ';'  */
+#line 152 "yacc.y"
+                                                {(yyval.nptr) = createExtern("print");}
+#line 1289 "yacc.tab.c"
+    break;
+
+  case 8: /* extern_list: EXTERN INT READ '(' ')' ';'  */
+#line 153 "yacc.y"
+                                          {(yyval.nptr) = createExtern("read");}
+#line 1295 "yacc.tab.c"
+    break;
+
+  case 9: /* block_open: '{'  */
+#line 157 "yacc.y"
+                 {
+    (yyval.ival) = !context->functionBody;
+    if ((yyval.ival)) {
+        context->symbols.pushScope();
+    }
+    context->functionBody = false;
+}
+#line 1307 "yacc.tab.c"
+    break;
+
+  case 10: /* block_stmt: block_open var_decls stmts '}'  */
+#line 166 "yacc.y"
+                                            {
+    if ((yyvsp[-3].ival)) {
+        context->symbols.popScope();
+    }
+    vector<astNode*>* new_vec = new (nothrow) vector<astNode*>();
+    if (!new_vec) {
+        yyerror(scanner, root, diag, context, "Failed to allocate memory for block statement.");
+        YYABORT;
+    }
+    new_vec->insert(new_vec->end(), (yyvsp[-2].svec_ptr)->begin(), (yyvsp[-2].svec_ptr)->end());
+    new_vec->insert(new_vec->end(), (yyvsp[-1].svec_ptr)->begin(), (yyvsp[-1].svec_ptr)->end());
+    (yyval.nptr) = createBlock(new_vec);
+    if ((yyval.nptr) == NULL) {
+        delete new_vec;  // Clean up vector if block creation fails
+        yyerror(scanner, root, diag, context, "Failed to create block node due to memory allocation failure.");
+        YYABORT;
+    }
+    delete (yyvsp[-2].svec_ptr);
+    delete (yyvsp[-1].svec_ptr);
+    LOG_DEBUG("line %d: block created", currentLine(scanner, context));
+    if (logEnabled(log_trace)) {
+        printNode((yyval.nptr));
+    }
+}
+#line 1336 "yacc.tab.c"
+    break;
+
+  case 11: /* block_stmt: block_open stmts '}'  */
+#line 190 "yacc.y"
+                                   {
+    if ((yyvsp[-2].ival)) {
+        context->symbols.popScope();
+    }
+    (yyval.nptr) = createBlock((yyvsp[-1].svec_ptr));
+    if ((yyval.nptr) == NULL) {
+        yyerror(scanner, root, diag, context, "Failed to create block node due to memory allocation failure.");
+        YYABORT;
+    }
+    LOG_DEBUG("line %d: simple block created", currentLine(scanner, context));
+    if (logEnabled(log_trace)) {
+        printNode((yyval.nptr));
+    }
+}
+#line 1355 "yacc.tab.c"
+    break;
+
+  case 12: /* var_decls: var_decls decl  */
+#line 206 "yacc.y"
+                                  {(yyval.svec_ptr) = (yyvsp[-1].svec_ptr);
+														 (yyval.svec_ptr)->push_back((yyvsp[0].nptr));}
+#line 1362 "yacc.tab.c"
+    break;
+
+  case 13: /* var_decls: decl  */
+#line 208 "yacc.y"
+                                                {(yyval.svec_ptr) = new vector<astNode*>();
+									 (yyval.svec_ptr)->push_back((yyvsp[0].nptr));}
+#line 1369 "yacc.tab.c"
+    break;
+
+  case 14: /* decl: INT ID ';'  */
+#line 212 "yacc.y"
+                  {
+    (yyval.nptr) = createDecl((yyvsp[-1].sym));
+    if ((yyval.nptr) == NULL) {
+        yyerror(scanner, root, diag, context, "Failed to create declaration node due to memory allocation failure.");
+        YYABORT;
+    }
+    declareVariable(scanner, diag, context, (yyvsp[-1].sym));
+}
+#line 1382 "yacc.tab.c"
+    break;
+
+  case 15: /* stmts: stmts stmt  */
+#line 222 "yacc.y"
+                   {
+    (yyvsp[-1].svec_ptr)->push_back((yyvsp[0].nptr));
+    (yyval.svec_ptr) = (yyvsp[-1].svec_ptr);
+}
+#line 1391 "yacc.tab.c"
+    break;
+
+  case 16: /* stmts: stmt  */
+#line 226 "yacc.y"
+              {
+    (yyval.svec_ptr) = new (nothrow) vector<astNode*>();
+    if (!(yyval.svec_ptr)) {
+        yyerror(scanner, root, diag, context, "Failed to allocate memory for statements.");
+        YYABORT;
+    }
+    (yyval.svec_ptr)->push_back((yyvsp[0].nptr));
+}
+#line 1404 "yacc.tab.c"
+    break;
+
+  case 17: /* print: PRINT '(' expr ')' ';'  */
+#line 236 "yacc.y"
+                               {(yyval.nptr) = createCall("print", (yyvsp[-2].nptr));}
+#line 1410 "yacc.tab.c"
+    break;
+
+  case 18: /* stmt: IF '(' cond_expr ')' stmt  */
+#line 239 "yacc.y"
+                                                               {(yyval.nptr) = createIf((yyvsp[-2].nptr), (yyvsp[0].nptr));}
+#line 1416 "yacc.tab.c"
+    break;
+
+  case 19: /* stmt: IF '(' cond_expr ')' stmt ELSE stmt  */
+#line 240 "yacc.y"
+                                                                      {(yyval.nptr) = createIf((yyvsp[-4].nptr), (yyvsp[-2].nptr), (yyvsp[0].nptr));}
+#line 1422 "yacc.tab.c"
+    break;
+
+  case 20: /* stmt: WHILE '(' cond_expr ')' block_stmt  */
+#line 241 "yacc.y"
+                                                                     {(yyval.nptr) = createWhile((yyvsp[-2].nptr), (yyvsp[0].nptr));}
+#line 1428 "yacc.tab.c"
+    break;
+
+  case 21: /* stmt: RETURN ';'  */
+#line 242 "yacc.y"
+                                             {(yyval.nptr) = createRet(NULL);}
+#line 1434 "yacc.tab.c"
+    break;
+
+  case 22: /* stmt: RETURN '(' expr ')' ';'  */
+#line 243 "yacc.y"
+                                                          {(yyval.nptr) = createRet((yyvsp[-2].nptr));}
+#line 1440 "yacc.tab.c"
+    break;
+
+  case 23: /* stmt: RETURN expr ';'  */
+#line 244 "yacc.y"
+                                      {(yyval.nptr) = createRet((yyvsp[-1].nptr));}
+#line 1446 "yacc.tab.c"
+    break;
+
+  case 24: /* stmt: block_stmt  */
+#line 245 "yacc.y"
+                                             {(yyval.nptr) = (yyvsp[0].nptr);}
+#line 1452 "yacc.tab.c"
+    break;
+
+  case 25: /* stmt: ID EQUALS expr ';'  */
+#line 246 "yacc.y"
+                                                     {useVariable(scanner, diag, context, (yyvsp[-3].sym)); astNode* tnptr = createVar((yyvsp[-3].sym)); (yyval.nptr) = createAsgn(tnptr, (yyvsp[-1].nptr));}
+#line 1458 "yacc.tab.c"
+    break;
+
+  case 26: /* stmt: print  */
+#line 247 "yacc.y"
+                                                {(yyval.nptr) = (yyvsp[0].nptr);}
+#line 1464 "yacc.tab.c"
+    break;
+
+  case 27: /* cond_expr: expr EQ expr  */
+#line 250 "yacc.y"
+                                       {(yyval.nptr) = createRExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), eq);}
+#line 1470 "yacc.tab.c"
+    break;
+
+  case 28: /* cond_expr: expr GT expr  */
+#line 251 "yacc.y"
+                                               {(yyval.nptr) = createRExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), gt);}
+#line 1476 "yacc.tab.c"
+    break;
+
+  case 29: /* cond_expr: expr LT expr  */
+#line 252 "yacc.y"
+                                               {(yyval.nptr) = createRExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), lt);}
+#line 1482 "yacc.tab.c"
+    break;
+
+  case 30: /* cond_expr: expr GTE expr  */
+#line 253 "yacc.y"
+                                                {(yyval.nptr) = createRExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), ge);}
+#line 1488 "yacc.tab.c"
+    break;
+
+  case 31: /* cond_expr: expr LTE expr  */
+#line 254 "yacc.y"
+                                                {(yyval.nptr) = createRExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), le);}
+#line 1494 "yacc.tab.c"
+    break;
+
+  case 32: /* expr: term PLUS term  */
+#line 257 "yacc.y"
+                                          {(yyval.nptr) = createBExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), add);}
+#line 1500 "yacc.tab.c"
+    break;
+
+  case 33: /* expr: term MINUS term  */
+#line 258 "yacc.y"
+                                                           {(yyval.nptr) = createBExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), sub);}
+#line 1506 "yacc.tab.c"
+    break;
+
+  case 34: /* expr: term MULT term  */
+#line 259 "yacc.y"
+                                                          {(yyval.nptr) = createBExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), mul);}
+#line 1512 "yacc.tab.c"
+    break;
+
+  case 35: /* expr: term DIV term  */
+#line 260 "yacc.y"
+                                                         {(yyval.nptr) = createBExpr((yyvsp[-2].nptr), (yyvsp[0].nptr), divide);}
+#line 1518 "yacc.tab.c"
+    break;
+
+  case 36: /* expr: READ '(' ')'  */
+#line 261 "yacc.y"
+                                    {(yyval.nptr) = createCall("read", NULL);}
+#line 1524 "yacc.tab.c"
+    break;
+
+  case 37: /* expr: term  */
+#line 262 "yacc.y"
+                                                {(yyval.nptr) = (yyvsp[0].nptr);}
+#line 1530 "yacc.tab.c"
+    break;
+
+  case 38: /* term: NUM  */
+#line 265 "yacc.y"
+                               {(yyval.nptr) = createCnst((yyvsp[0].ival));}
+#line 1536 "yacc.tab.c"
+    break;
+
+  case 39: /* term: ID  */
+#line 266 "yacc.y"
+                                              {useVariable(scanner, diag, context, (yyvsp[0].sym)); (yyval.nptr) = createVar((yyvsp[0].sym));}
+#line 1542 "yacc.tab.c"
+    break;
+
+  case 40: /* term: MINUS term  */
+#line 267 "yacc.y"
+                                                      {(yyval.nptr) = createUExpr((yyvsp[0].nptr), uminus);}
+#line 1548 "yacc.tab.c"
+    break;
+
+
+#line 1552 "yacc.tab.c"
+
+      default: break;
+    }
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
+
+  YYPOPSTACK (yylen);
+  yylen = 0;
+
+  *++yyvsp = yyval;
+
+  /* Now 'shift' the result of the reduction.  Determine what state
+     that goes to, based on the state we popped back to and the rule
+     number reduced by.  */
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
+
+  goto yynewstate;
+
+
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
+yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
+  /* If not already recovering from an error, report this error.  */
+  if (!yyerrstatus)
+    {
+      ++yynerrs;
+      yyerror (scanner, root, diag, context, YY_("syntax error"));
+    }
+
+  if (yyerrstatus == 3)
+    {
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
+
+      if (yychar <= YYEOF)
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
+      else
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval, scanner, root, diag, context);
+          yychar = YYEMPTY;
+        }
+    }
+
+  /* Else will try to reuse lookahead token after shifting the error
+     token.  */
+  goto yyerrlab1;
+
+
+/*---------------------------------------------------.
+| yyerrorlab -- error raised explicitly by YYERROR.  |
+`---------------------------------------------------*/
+yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
+
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYERROR.  */
+  YYPOPSTACK (yylen);
+  yylen = 0;
+  YY_STACK_PRINT (yyss, yyssp);
+  yystate = *yyssp;
+  goto yyerrlab1;
+
+
+/*-------------------------------------------------------------.
+| yyerrlab1 -- common code for both syntax error and YYERROR.  |
+`-------------------------------------------------------------*/
+yyerrlab1:
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
+
+  /* Pop stack until we find a state that shifts the error token.  */
+  for (;;)
+    {
+      yyn = yypact[yystate];
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
+
+      /* Pop the current state because it cannot handle the error token.  */
+      if (yyssp == yyss)
+        YYABORT;
+
+
+      yydestruct ("Error: popping",
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, scanner, root, diag, context);
+      YYPOPSTACK (1);
+      yystate = *yyssp;
+      YY_STACK_PRINT (yyss, yyssp);
+    }
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+
+  /* Shift the error token.  */
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
+
+  yystate = yyn;
+  goto yynewstate;
+
+
+/*-------------------------------------.
+| yyacceptlab -- YYACCEPT comes here.  |
+`-------------------------------------*/
+yyacceptlab:
+  yyresult = 0;
+  goto yyreturnlab;
+
+
+/*-----------------------------------.
+| yyabortlab -- YYABORT comes here.  |
+`-----------------------------------*/
+yyabortlab:
+  yyresult = 1;
+  goto yyreturnlab;
+
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
+yyexhaustedlab:
+  yyerror (scanner, root, diag, context, YY_("memory exhausted"));
+  yyresult = 2;
+  goto yyreturnlab;
+
+
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval, scanner, root, diag, context);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
+     this YYABORT or YYACCEPT.  */
+  YYPOPSTACK (yylen);
+  YY_STACK_PRINT (yyss, yyssp);
+  while (yyssp != yyss)
+    {
+      yydestruct ("Cleanup: popping",
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, scanner, root, diag, context);
+      YYPOPSTACK (1);
+    }
+#ifndef yyoverflow
+  if (yyss != yyssa)
+    YYSTACK_FREE (yyss);
+#endif
+
+  return yyresult;
+}
+
+#line 269 "yacc.y"
+
+void yyerror(yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context, const char *s){
+	diag->errors.push_back({diag_syntax, currentLine(scanner, context), s});
+}
+
+// declarations and uses are checked as they are reduced, with the same rules and messages as visitNode. Semantic
+// errors are reported but do not stop the parse
+static void declareVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name){
+	if (!context->symbols.declare(name)) {
+		diag->errors.push_back({diag_redeclared, currentLine(scanner, context),
+		                        std::string("Variable has already been declared: '") + symbolName(name) + "'"});
+	}
+}
+
+static void useVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name){
+	if (!context->symbols.isDeclared(name)) {
+		diag->errors.push_back({diag_undeclared, currentLine(scanner, context),
+		                        std::string("Variable has not been declared. '") + symbolName(name) + "'"});
+	}
+}
+
+static std::atomic<int> parserScanner(scanner_mapped);
+
+void setParserScanner(scanner_type scanner){
+	parserScanner = scanner;
+}
+
+scanner_type getParserScanner(){
+	return (scanner_type) parserScanner.load();
+}
+
+// parses in through the flex scanner
+static astNode* parseStream(FILE* in, ParseDiagnostics& diag){
+	yyscan_t scanner;
+	if (yylex_init(&scanner) != 0) {
+		diag.errors.push_back({diag_io, 0, "failed to allocate scanner"});
+		return NULL;
+	}
+	yyset_in(in, scanner);
+
+	astNode* root = NULL;
+	ParseContext context;
+	int status = yyparse(scanner, &root, &diag, &context);
+
+	yylex_destroy(scanner);
+	return status == 0 ? root : NULL;
+}
+
+// parses the file through the flex scanner, reading it with stdio
+static astNode* parseWithFlex(const char* path, ParseDiagnostics& diag){
+	FILE* in = fopen(path, "r");
+	if (in == NULL) {
+		diag.errors.push_back({diag_io, 0, std::string("cannot open ") + path});
+		return NULL;
+	}
+	astNode* root = parseStream(in, diag);
+	METRIC_COUNT(counter_bytes_read, ftell(in));
+	fclose(in);
+	return root;
+}
+
+// parses size bytes at data through a MiniCScanner
+static astNode* parseBytes(const char* data, size_t size, ParseDiagnostics& diag){
+	MiniCScanner scanner(data, size);
+	astNode* root = NULL;
+	ParseContext context;
+	context.mapped = &scanner;
+	int status = yyparse(NULL, &root, &diag, &context);
+	return status == 0 ? root : NULL;
+}
+
+// parses the file through a MiniCScanner over a mapping of it
+static astNode* parseMapped(const char* path, ParseDiagnostics& diag){
+	MappedSource source;
+	if (!source.open(path)) {
+		diag.errors.push_back({diag_io, 0, std::string("cannot open ") + path});
+		return NULL;
+	}
+	METRIC_COUNT(counter_bytes_read, source.size());
+	return parseBytes(source.data(), source.size(), diag);
+}
+
+astNode* parseFile(const char* path, ParseDiagnostics& diag){
+	METRIC_PHASE(phase_parse);
+	METRIC_COUNT(counter_files_parsed, 1);
+	if (getParserScanner() == scanner_flex) {
+		return parseWithFlex(path, diag);
+	}
+	return parseMapped(path, diag);
+}
+
+astNode* parseSource(const char* data, size_t size, ParseDiagnostics& diag){
+	METRIC_PHASE(phase_parse);
+	METRIC_COUNT(counter_files_parsed, 1);
+	if (getParserScanner() == scanner_mapped) {
+		return parseBytes(data, size, diag);
+	}
+	// the flex scanner reads a stream, so it gets one over the buffer
+	FILE* in = fmemopen((void*) data, size, "r");
+	if (in == NULL) {
+		diag.errors.push_back({diag_io, 0, "cannot open the source buffer"});
+		return NULL;
+	}
+	astNode* root = parseStream(in, diag);
+	fclose(in);
+	return root;
+}
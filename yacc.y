@@ -1,41 +1,96 @@
 /*
 *	MiniC Compiler - Bison Grammar File
 *
-*   Purpose: In this Bison file, we handle grammar rules and include a main function where we call yyparse(); to parse our
-*   input file. We then build the AST and conduct semantic analysis on the tree in the semantic_analysis.c file, using an algorithm given by
-*   Vasanta. We also free all memory allocated to the tree using Vasanta's ast library. 
+*   Purpose: In this Bison file, we handle grammar rules and provide parseFile(), which runs a reentrant yyparse(); over our
+*   input file. We build the AST and run the semantic checks of semantic_analysis.c (use before declaration, duplicate
+*   declarations) as the reductions happen, so every file is checked in the same pass that parses it. We also free all
+*   memory allocated to the tree using Vasanta's ast library. 
 * 
 * 	Author: Carly Retterer
 * 	Date: 4/16/2024
 */
 
-%{
-#include <stdio.h>
+%code requires {
 #include "ast.h"
+#include "parser.h"
+
+// opaque flex scanner handle, declared the same way lex.yy.c declares it
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
+
+struct ParseContext;
+}
+
+%code {
+#include <stdio.h>
 #include <vector>
 #include <stack>
-#include "semantic_analysis.h"
+#include "scoped_symbol_table.h"
 #include <string>
+#include <atomic>
+#include "logging.h"
+#include "metrics.h"
+#include "scanner.h"
+
+// Semantic checks done while parsing: the scopes open at the current point of the input, and whether the block
+// about to open is a function body, whose declarations share the scope of the parameter. Tokens come from mapped
+// when it is set and from the flex scanner otherwise
+struct ParseContext {
+    ScopedSymbolTable symbols;
+    bool functionBody = false;
+    MiniCScanner *mapped = NULL;
+};
 
-extern int yylex();
-extern int yylex_destroy();
-extern int yywrap();
-int yyerror(const char *);
-extern FILE * yyin;
-using SymbolTable = std::vector<std::string>;
-astNode* rootNode = NULL;
+extern int yylex(YYSTYPE *yylval_param, yyscan_t scanner);
+extern int yylex_init(yyscan_t *scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern void yyset_in(FILE *in, yyscan_t scanner);
+extern int yyget_lineno(yyscan_t scanner);
+void yyerror(yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context, const char *s);
+static void declareVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name);
+static void useVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name);
+
+// the parser reads its tokens through here, from whichever scanner the file is read with. Tokens are counted
+// (and, with MINIC_METRICS=2, the scanner is timed)
+static int nextToken(YYSTYPE *value, yyscan_t scanner, ParseContext *context) {
+    METRIC_LEX_PHASE();
+    METRIC_COUNT(counter_tokens, 1);
+    if (context->mapped == NULL) {
+        return yylex(value, scanner);
+    }
+    MappedToken token;
+    int kind = context->mapped->next(token);
+    if (kind == ID) {
+        value->sym = context->mapped->symbol(token);
+    } else if (kind == NUM) {
+        value->ival = context->mapped->number(token);
+    }
+    return kind;
+}
+#define yylex nextToken
+
+static int currentLine(yyscan_t scanner, ParseContext *context) {
+    return context->mapped != NULL ? context->mapped->line() : yyget_lineno(scanner);
+}
+}
 
-%}
+// pure parser: the scanner, the result and the diagnostics are all passed in, nothing is global
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {astNode **root} {ParseDiagnostics *diag}
+%param {ParseContext *context}
 
 %union{
     int ival;
-    char *sname;
+    symbol_id sym;
     astNode *nptr;
     vector<astNode*> *svec_ptr;
 }
 
 %token <ival> NUM
-%token <sname> ID
+%token <sym> ID
 %token PLUS MINUS MULT DIV INT
 %token EXTERN VOID IF ELSE WHILE RETURN READ PRINT
 %token EQ GT LT GTE LTE EQUALS
@@ -46,6 +101,7 @@ astNode* rootNode = NULL;
 %left PLUS MINUS
 %left MULT DIV
 
+%type <ival> block_open
 %type <svec_ptr> stmts var_decls
 %type <nptr> stmt expr term block_stmt decl func cond_expr prog extern_list print  //non-terminals
 %start prog
@@ -54,51 +110,66 @@ astNode* rootNode = NULL;
 %%
 
 // function node: followed by func name, possible param, and block stmt
-func : INT ID '(' ')' block_stmt {
-    $$ = createFunc($2, NULL, $5);
+func : INT ID '(' ')' {
+    context->symbols.pushScope();
+    context->functionBody = true;
+    } block_stmt {
+    context->symbols.popScope();
+    $$ = createFunc($2, NULL, $6);
     if ($$ == NULL) {
-        yyerror("Failed to create function node due to memory allocation failure.");
+        yyerror(scanner, root, diag, context, "Failed to create function node due to memory allocation failure.");
         YYABORT;
     }
-    printf("non-parametric function created\n");
-    free($2);
+    LOG_DEBUG("line %d: function '%s' created", currentLine(scanner, context), symbolName($2));
 	}
 
-     | INT ID '(' INT ID ')' block_stmt {
-    $$ = createFunc($2, createVar($5), $7);
-    if ($$ == NULL || $7 == NULL) {
-        yyerror("Failed to create function node with parameters due to memory allocation failure.");
+     | INT ID '(' INT ID ')' {
+    // the parameter is declared in the scope the body's declarations go into
+    context->symbols.pushScope();
+    context->symbols.declare($5);
+    context->functionBody = true;
+    } block_stmt {
+    context->symbols.popScope();
+    $$ = createFunc($2, createVar($5), $8);
+    if ($$ == NULL || $8 == NULL) {
+        yyerror(scanner, root, diag, context, "Failed to create function node with parameters due to memory allocation failure.");
         YYABORT;
     }
-    printf("Function with parameters created\n");
-    free($2);
-    free($5);
+    LOG_DEBUG("line %d: function '%s' with parameter '%s' created", currentLine(scanner, context), symbolName($2), symbolName($5));
 }
 
 // program node : can be followed by extern read and extern print
 prog : extern_list extern_list func {
-    printf("Creating program node...\n");
     $$ = createProg($1, $2, $3);
-    printf("createProg returned: %p\n", $$);  // Assuming $$ is a pointer
     if ($$ == NULL) {
-        yyerror("Failed to create program node due to memory allocation failure.");
+        yyerror(scanner, root, diag, context, "Failed to create program node due to memory allocation failure.");
         YYABORT;
     }
-    rootNode = $$;
-    if (rootNode == NULL) {
-        fprintf(stderr, "Error: rootNode wasn't initialized at the beginning\n");
-    }
+    *root = $$;
 }
 
 // extern_list non terminal followed by extern print node or possible extern read node
 extern_list : EXTERN VOID PRINT '(' INT ')' ';' {$$ = createExtern("print");}
             | EXTERN INT READ '(' ')' ';' {$$ = createExtern("read");} 
 
+// opening brace of a block: opens the block's scope, except for a function body, which uses the function's.
+// The value says whether a scope was opened
+block_open : '{' {
+    $$ = !context->functionBody;
+    if ($$) {
+        context->symbols.pushScope();
+    }
+    context->functionBody = false;
+}
+
 // block stmt code taken from ex given by Vasanta, with modifications for debugging purposes and errors checks
-block_stmt : '{' var_decls stmts '}' {
+block_stmt : block_open var_decls stmts '}' {
+    if ($1) {
+        context->symbols.popScope();
+    }
     vector<astNode*>* new_vec = new (nothrow) vector<astNode*>();
     if (!new_vec) {
-        yyerror("Failed to allocate memory for block statement.");
+        yyerror(scanner, root, diag, context, "Failed to allocate memory for block statement.");
         YYABORT;
     }
     new_vec->insert(new_vec->end(), $2->begin(), $2->end());
@@ -106,22 +177,29 @@ block_stmt : '{' var_decls stmts '}' {
     $$ = createBlock(new_vec);
     if ($$ == NULL) {
         delete new_vec;  // Clean up vector if block creation fails
-        yyerror("Failed to create block node due to memory allocation failure.");
+        yyerror(scanner, root, diag, context, "Failed to create block node due to memory allocation failure.");
         YYABORT;
     }
-    printNode($$);
     delete $2;
     delete $3;
-    printf("block created\n");
+    LOG_DEBUG("line %d: block created", currentLine(scanner, context));
+    if (logEnabled(log_trace)) {
+        printNode($$);
+    }
 }
-            | '{' stmts '}' {
+            | block_open stmts '}' {
+    if ($1) {
+        context->symbols.popScope();
+    }
     $$ = createBlock($2);
     if ($$ == NULL) {
-        yyerror("Failed to create block node due to memory allocation failure.");
+        yyerror(scanner, root, diag, context, "Failed to create block node due to memory allocation failure.");
         YYABORT;
     }
-    printNode($$);
-    printf("Simple block created\n");
+    LOG_DEBUG("line %d: simple block created", currentLine(scanner, context));
+    if (logEnabled(log_trace)) {
+        printNode($$);
+    }
 }
 
 // var declarations, with code given by Vasanta
@@ -134,10 +212,10 @@ var_decls	 : var_decls decl {$$ = $1;
 decl : INT ID ';' {
     $$ = createDecl($2);
     if ($$ == NULL) {
-        yyerror("Failed to create declaration node due to memory allocation failure.");
+        yyerror(scanner, root, diag, context, "Failed to create declaration node due to memory allocation failure.");
         YYABORT;
     }
-    free($2);
+    declareVariable(scanner, diag, context, $2);
 }
 
 // statement nodes with code given by Vasanta, modified for debugging purposes
@@ -148,7 +226,7 @@ stmts : stmts stmt {
        | stmt {
     $$ = new (nothrow) vector<astNode*>();
     if (!$$) {
-        yyerror("Failed to allocate memory for statements.");
+        yyerror(scanner, root, diag, context, "Failed to allocate memory for statements.");
         YYABORT;
     }
     $$->push_back($1);
@@ -165,7 +243,7 @@ stmt 			: IF '(' cond_expr ')' stmt %prec THEN {$$ = createIf($3, $5);}
      				| RETURN '(' expr ')' ';' {$$ = createRet($3);}
                     | RETURN expr ';' {$$ = createRet($2);}
      				| block_stmt {$$ = $1;}
-     				| ID EQUALS expr ';' {astNode* tnptr = createVar($1); $$ = createAsgn(tnptr, $3); free($1);}
+     				| ID EQUALS expr ';' {useVariable(scanner, diag, context, $1); astNode* tnptr = createVar($1); $$ = createAsgn(tnptr, $3);}
 					| print {$$ = $1;}
      				;
 
@@ -185,11 +263,113 @@ expr			 : term PLUS term {$$ = createBExpr($1, $3, add);}
                      ;
 
 term			 : NUM {$$ = createCnst($1);}
-					 | ID {$$ = createVar($1); free($1);}
+					 | ID {useVariable(scanner, diag, context, $1); $$ = createVar($1);}
 					 | MINUS term {$$ = createUExpr($2, uminus);}
 
 %%
-int yyerror(const char *s){
-	fprintf(stderr,"%s\n", s);
-	return 0;
-}
\ No newline at end of file
+void yyerror(yyscan_t scanner, astNode **root, ParseDiagnostics *diag, ParseContext *context, const char *s){
+	diag->errors.push_back({diag_syntax, currentLine(scanner, context), s});
+}
+
+// declarations and uses are checked as they are reduced, with the same rules and messages as visitNode. Semantic
+// errors are reported but do not stop the parse
+static void declareVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name){
+	if (!context->symbols.declare(name)) {
+		diag->errors.push_back({diag_redeclared, currentLine(scanner, context),
+		                        std::string("Variable has already been declared: '") + symbolName(name) + "'"});
+	}
+}
+
+static void useVariable(yyscan_t scanner, ParseDiagnostics *diag, ParseContext *context, symbol_id name){
+	if (!context->symbols.isDeclared(name)) {
+		diag->errors.push_back({diag_undeclared, currentLine(scanner, context),
+		                        std::string("Variable has not been declared. '") + symbolName(name) + "'"});
+	}
+}
+
+static std::atomic<int> parserScanner(scanner_mapped);
+
+void setParserScanner(scanner_type scanner){
+	parserScanner = scanner;
+}
+
+scanner_type getParserScanner(){
+	return (scanner_type) parserScanner.load();
+}
+
+// parses in through the flex scanner
+static astNode* parseStream(FILE* in, ParseDiagnostics& diag){
+	yyscan_t scanner;
+	if (yylex_init(&scanner) != 0) {
+		diag.errors.push_back({diag_io, 0, "failed to allocate scanner"});
+		return NULL;
+	}
+	yyset_in(in, scanner);
+
+	astNode* root = NULL;
+	ParseContext context;
+	int status = yyparse(scanner, &root, &diag, &context);
+
+	yylex_destroy(scanner);
+	return status == 0 ? root : NULL;
+}
+
+// parses the file through the flex scanner, reading it with stdio
+static astNode* parseWithFlex(const char* path, ParseDiagnostics& diag){
+	FILE* in = fopen(path, "r");
+	if (in == NULL) {
+		diag.errors.push_back({diag_io, 0, std::string("cannot open ") + path});
+		return NULL;
+	}
+	astNode* root = parseStream(in, diag);
+	METRIC_COUNT(counter_bytes_read, ftell(in));
+	fclose(in);
+	return root;
+}
+
+// parses size bytes at data through a MiniCScanner
+static astNode* parseBytes(const char* data, size_t size, ParseDiagnostics& diag){
+	MiniCScanner scanner(data, size);
+	astNode* root = NULL;
+	ParseContext context;
+	context.mapped = &scanner;
+	int status = yyparse(NULL, &root, &diag, &context);
+	return status == 0 ? root : NULL;
+}
+
+// parses the file through a MiniCScanner over a mapping of it
+static astNode* parseMapped(const char* path, ParseDiagnostics& diag){
+	MappedSource source;
+	if (!source.open(path)) {
+		diag.errors.push_back({diag_io, 0, std::string("cannot open ") + path});
+		return NULL;
+	}
+	METRIC_COUNT(counter_bytes_read, source.size());
+	return parseBytes(source.data(), source.size(), diag);
+}
+
+astNode* parseFile(const char* path, ParseDiagnostics& diag){
+	METRIC_PHASE(phase_parse);
+	METRIC_COUNT(counter_files_parsed, 1);
+	if (getParserScanner() == scanner_flex) {
+		return parseWithFlex(path, diag);
+	}
+	return parseMapped(path, diag);
+}
+
+astNode* parseSource(const char* data, size_t size, ParseDiagnostics& diag){
+	METRIC_PHASE(phase_parse);
+	METRIC_COUNT(counter_files_parsed, 1);
+	if (getParserScanner() == scanner_mapped) {
+		return parseBytes(data, size, diag);
+	}
+	// the flex scanner reads a stream, so it gets one over the buffer
+	FILE* in = fmemopen((void*) data, size, "r");
+	if (in == NULL) {
+		diag.errors.push_back({diag_io, 0, "cannot open the source buffer"});
+		return NULL;
+	}
+	astNode* root = parseStream(in, diag);
+	fclose(in);
+	return root;
+}